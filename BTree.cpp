@@ -0,0 +1,648 @@
+#pragma once
+
+#include <algorithm>
+#include <concepts>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Tree.cpp"
+
+/// <h1> BTree Declaration
+/// <b> B-tree set whose nodes hold up to kMaxKeys sorted keys, as many as
+/// <b> fit in about NodeBytes bytes, so a lookup takes one cache miss per
+/// <b> level of a much shallower tree than a binary one. Inner nodes also
+/// <b> hold kMaxKeys + 1 child pointers; leaves hold none.
+/// <b> Insert and remove are top-down and single pass (CLRS): full nodes
+/// <b> are split on the way down and minimal ones refilled, so nothing has
+/// <b> to be fixed on the way back up. Keys are moved between slots and
+/// <b> nodes, so T must be nothrow movable.
+template <std::totally_ordered T, size_t NodeBytes = 256,
+          typename Allocator = std::allocator<T>>
+class BTree : public SearchTree<T> {
+  static_assert(std::is_nothrow_move_constructible_v<T> &&
+                    std::is_nothrow_move_assignable_v<T>,
+                "BTree moves keys between nodes");
+  static_assert(NodeBytes / sizeof(T) < UINT16_MAX, "node too large");
+
+ public:
+  using value_type = T;
+  using allocator_type = Allocator;
+
+  /// <b> every node but the root holds between kMinDegree - 1 and
+  /// <b> kMaxKeys = 2 * kMinDegree - 1 keys
+  static constexpr size_t kMinDegree =
+      std::max<size_t>(2, NodeBytes / sizeof(T) / 2);
+  static constexpr size_t kMaxKeys = 2 * kMinDegree - 1;
+
+  BTree() = default;
+  explicit BTree(const Allocator&);
+  BTree(const BTree&);
+  BTree(BTree&&);
+  ~BTree() override;
+
+  void insert(const T&) override;
+  void insert(T&&) override;
+
+  /// <b> removes the first value of the root node
+  void remove() override;
+  void remove(T) override;
+
+  T& min() override;
+  T& max() override;
+
+  bool hasElement(const T&) const override;
+
+  /// <b> replaces the contents with the ascending values of [first, last),
+  /// <b> equal neighbours being dropped; fills nodes left to right in O(n)
+  /// <b> instead of descending once per value, and leaves every node but
+  /// <b> those on the right edge full
+  template <std::input_iterator InputIt>
+  void bulkLoad(InputIt first, InputIt last);
+
+  bool empty() const;
+
+ private:
+  struct Node;
+  struct InnerNode;
+  using NodePtr = Node*;
+  using LeafAllocator = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<Node>;
+  using InnerAllocator = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<InnerNode>;
+  using LeafTraits = std::allocator_traits<LeafAllocator>;
+  using InnerTraits = std::allocator_traits<InnerAllocator>;
+
+  /// <b> allocate an empty leaf or inner node
+  NodePtr createNode(bool is_leaf);
+
+  /// <b> destroy the keys of 'node' and free it, not its children
+  void destroyNode(NodePtr node);
+
+  /// <b> destroy 'node' and every node below it
+  void destroySubtree(NodePtr node);
+
+  /// <b> deep copy of the subtree at 'node'
+  NodePtr copySubtree(const Node* node);
+
+  /// <b> index of the first key of 'node' that is not less than 'value'
+  static size_t lowerBound(const Node* node, const T& value);
+
+  /// <b> split the full child 'index' of 'parent', which is not full, in
+  /// <b> two and move its middle key up into 'parent'
+  void splitChild(NodePtr parent, size_t index);
+
+  /// <b> make sure child 'index' of 'parent' has at least kMinDegree keys
+  /// <b> by borrowing from or merging with a sibling; returns the node that
+  /// <b> now covers the child's key range
+  NodePtr fillChild(NodePtr parent, size_t index);
+
+  /// <b> move one key from a sibling through 'parent' into child 'index'
+  static void borrowFromLeft(NodePtr parent, size_t index);
+  static void borrowFromRight(NodePtr parent, size_t index);
+
+  /// <b> merge child 'index + 1' and the key between them into child
+  /// <b> 'index'
+  void mergeChildren(NodePtr parent, size_t index);
+
+  /// <b> remove and return the max/min value below 'node', which has at
+  /// <b> least kMinDegree keys
+  T extractMax(NodePtr node);
+  T extractMin(NodePtr node);
+
+  /// <b> drop an empty root, making its only child the new root
+  void shrinkRoot();
+
+  template <typename V>
+  void insertValue(V&& value);
+
+  LeafAllocator leaf_alloc_;
+  InnerAllocator inner_alloc_{leaf_alloc_};
+  NodePtr root_{nullptr};
+};
+
+/// <h1> Node Declaration
+template <std::totally_ordered T, size_t NodeBytes, typename Allocator>
+struct BTree<T, NodeBytes, Allocator>::Node {
+  uint16_t count{0};
+  bool is_leaf{true};
+  /// <b> keys [0, count) are alive
+  alignas(T) unsigned char storage[sizeof(T) * kMaxKeys];
+
+  explicit Node(bool leaf) : is_leaf(leaf) {}
+
+  T* keys() { return std::launder(reinterpret_cast<T*>(storage)); }
+  const T* keys() const {
+    return std::launder(reinterpret_cast<const T*>(storage));
+  }
+
+  bool isFull() const { return count == kMaxKeys; }
+
+  /// <b> children of an inner node; must not be called on a leaf
+  NodePtr* children() { return static_cast<InnerNode*>(this)->children; }
+  const NodePtr* children() const {
+    return static_cast<const InnerNode*>(this)->children;
+  }
+
+  /// <b> put a value at 'index', shifting later keys right; if building
+  /// <b> the value throws, the node is left as it was
+  template <typename V>
+  void insertKey(size_t index, V&& value);
+
+  /// <b> destroy the key at 'index', shifting later keys left
+  void eraseKey(size_t index);
+
+  /// <b> move keys [from, count) to the end of 'other'
+  void moveKeysTo(size_t from, Node& other);
+};
+
+template <std::totally_ordered T, size_t NodeBytes, typename Allocator>
+struct BTree<T, NodeBytes, Allocator>::InnerNode : Node {
+  NodePtr children[kMaxKeys + 1] = {};
+
+  InnerNode() : Node(false) {}
+};
+
+/// <h1> Node Implementation
+
+template <std::totally_ordered T, size_t NodeBytes, typename Allocator>
+template <typename V>
+void BTree<T, NodeBytes, Allocator>::Node::insertKey(size_t index,
+                                                     V&& value) {
+  T* slots = keys();
+  for (size_t i = count; i > index; --i) {
+    std::construct_at(slots + i, std::move(slots[i - 1]));
+    std::destroy_at(slots + i - 1);
+  }
+  try {
+    std::construct_at(slots + index, std::forward<V>(value));
+  } catch (...) {
+    for (size_t i = index; i < count; ++i) {
+      std::construct_at(slots + i, std::move(slots[i + 1]));
+      std::destroy_at(slots + i + 1);
+    }
+    throw;
+  }
+  ++count;
+}
+
+template <std::totally_ordered T, size_t NodeBytes, typename Allocator>
+void BTree<T, NodeBytes, Allocator>::Node::eraseKey(size_t index) {
+  T* slots = keys();
+  std::destroy_at(slots + index);
+  for (size_t i = index + 1; i < count; ++i) {
+    std::construct_at(slots + i - 1, std::move(slots[i]));
+    std::destroy_at(slots + i);
+  }
+  --count;
+}
+
+template <std::totally_ordered T, size_t NodeBytes, typename Allocator>
+void BTree<T, NodeBytes, Allocator>::Node::moveKeysTo(size_t from,
+                                                      Node& other) {
+  T* slots = keys();
+  for (size_t i = from; i < count; ++i) {
+    std::construct_at(other.keys() + other.count++, std::move(slots[i]));
+    std::destroy_at(slots + i);
+  }
+  count = static_cast<uint16_t>(from);
+}
+
+/// <h1> BTree Implementation
+
+template <std::totally_ordered T, size_t NodeBytes, typename Allocator>
+BTree<T, NodeBytes, Allocator>::BTree(const Allocator& alloc)
+    : leaf_alloc_(alloc) {}
+
+template <std::totally_ordered T, size_t NodeBytes, typename Allocator>
+BTree<T, NodeBytes, Allocator>::BTree(const BTree& other)
+    : leaf_alloc_(
+          LeafTraits::select_on_container_copy_construction(other.leaf_alloc_)),
+      root_(other.root_ == nullptr ? nullptr : copySubtree(other.root_)) {}
+
+template <std::totally_ordered T, size_t NodeBytes, typename Allocator>
+BTree<T, NodeBytes, Allocator>::BTree(BTree&& other)
+    : leaf_alloc_(std::move(other.leaf_alloc_)),
+      inner_alloc_(std::move(other.inner_alloc_)),
+      root_(std::exchange(other.root_, nullptr)) {}
+
+template <std::totally_ordered T, size_t NodeBytes, typename Allocator>
+BTree<T, NodeBytes, Allocator>::~BTree() {
+  destroySubtree(root_);
+}
+
+template <std::totally_ordered T, size_t NodeBytes, typename Allocator>
+void BTree<T, NodeBytes, Allocator>::insert(const T& value) {
+  insertValue(value);
+}
+
+template <std::totally_ordered T, size_t NodeBytes, typename Allocator>
+void BTree<T, NodeBytes, Allocator>::insert(T&& value) {
+  insertValue(std::move(value));
+}
+
+template <std::totally_ordered T, size_t NodeBytes, typename Allocator>
+template <typename V>
+void BTree<T, NodeBytes, Allocator>::insertValue(V&& value) {
+  if (root_ == nullptr) {
+    NodePtr leaf = createNode(true);
+    try {
+      leaf->insertKey(0, std::forward<V>(value));
+    } catch (...) {
+      destroyNode(leaf);
+      throw;
+    }
+    root_ = leaf;
+    return;
+  }
+  if (root_->isFull()) {
+    NodePtr new_root = createNode(false);
+    new_root->children()[0] = root_;
+    root_ = new_root;
+    splitChild(root_, 0);
+  }
+  NodePtr node = root_;
+  while (true) {
+    size_t index = lowerBound(node, value);
+    if (index < node->count && !(value < node->keys()[index])) {
+      return;
+    }
+    if (node->is_leaf) {
+      node->insertKey(index, std::forward<V>(value));
+      return;
+    }
+    if (node->children()[index]->isFull()) {
+      splitChild(node, index);
+      if (node->keys()[index] < value) {
+        ++index;
+      } else if (!(value < node->keys()[index])) {
+        return;
+      }
+    }
+    node = node->children()[index];
+  }
+}
+
+template <std::totally_ordered T, size_t NodeBytes, typename Allocator>
+void BTree<T, NodeBytes, Allocator>::remove() {
+  if (root_ != nullptr) {
+    remove(root_->keys()[0]);
+  }
+}
+
+template <std::totally_ordered T, size_t NodeBytes, typename Allocator>
+void BTree<T, NodeBytes, Allocator>::remove(T value) {
+  NodePtr node = root_;
+  while (node != nullptr) {
+    const size_t kIndex = lowerBound(node, value);
+    const bool kFound =
+        kIndex < node->count && !(value < node->keys()[kIndex]);
+    if (node->is_leaf) {
+      if (kFound) {
+        node->eraseKey(kIndex);
+      }
+      break;
+    }
+    if (!kFound) {
+      node = fillChild(node, kIndex);
+      continue;
+    }
+    // The value sits in an inner node: replace it with its predecessor or
+    // successor, or, if both neighbours are minimal, merge them around it
+    // and carry on in the merged node.
+    NodePtr left = node->children()[kIndex];
+    NodePtr right = node->children()[kIndex + 1];
+    if (left->count >= kMinDegree) {
+      node->keys()[kIndex] = extractMax(left);
+      break;
+    }
+    if (right->count >= kMinDegree) {
+      node->keys()[kIndex] = extractMin(right);
+      break;
+    }
+    mergeChildren(node, kIndex);
+    node = left;
+  }
+  shrinkRoot();
+}
+
+template <std::totally_ordered T, size_t NodeBytes, typename Allocator>
+T& BTree<T, NodeBytes, Allocator>::min() {
+  NodePtr node = root_;
+  while (!node->is_leaf) {
+    node = node->children()[0];
+  }
+  return node->keys()[0];
+}
+
+template <std::totally_ordered T, size_t NodeBytes, typename Allocator>
+T& BTree<T, NodeBytes, Allocator>::max() {
+  NodePtr node = root_;
+  while (!node->is_leaf) {
+    node = node->children()[node->count];
+  }
+  return node->keys()[node->count - 1];
+}
+
+template <std::totally_ordered T, size_t NodeBytes, typename Allocator>
+bool BTree<T, NodeBytes, Allocator>::hasElement(const T& value) const {
+  const Node* node = root_;
+  while (node != nullptr) {
+    const size_t kIndex = lowerBound(node, value);
+    if (kIndex < node->count && !(value < node->keys()[kIndex])) {
+      return true;
+    }
+    node = node->is_leaf ? nullptr : node->children()[kIndex];
+  }
+  return false;
+}
+
+template <std::totally_ordered T, size_t NodeBytes, typename Allocator>
+template <std::input_iterator InputIt>
+void BTree<T, NodeBytes, Allocator>::bulkLoad(InputIt first, InputIt last) {
+  BTree built{Allocator(leaf_alloc_)};
+  // open[level] is the rightmost node of that level, the only one that may
+  // not be full yet; level 0 holds the leaves.
+  std::vector<NodePtr> open;
+  std::vector<NodePtr> fresh;
+  const T* previous = nullptr;
+  for (; first != last; ++first) {
+    T value(*first);
+    if (previous == nullptr) {
+      built.root_ = built.createNode(true);
+      built.root_->insertKey(0, std::move(value));
+      open.push_back(built.root_);
+      previous = built.root_->keys();
+      continue;
+    }
+    if (!(*previous < value)) {
+      continue;
+    }
+    // A value that doesn't fit in the open node of a level becomes the key
+    // between that node and a new one, one level up. The new nodes are
+    // allocated before anything is linked, so a failure leaves 'built'
+    // whole.
+    size_t full = 0;
+    while (full < open.size() && open[full]->isFull()) {
+      ++full;
+    }
+    fresh.reserve(open.size() + 1);
+    try {
+      for (size_t level = 0; level < full; ++level) {
+        fresh.push_back(built.createNode(level == 0));
+      }
+      if (full == open.size()) {
+        fresh.push_back(built.createNode(false));
+      }
+    } catch (...) {
+      for (NodePtr node : fresh) {
+        built.destroyNode(node);
+      }
+      throw;
+    }
+    if (full == open.size()) {
+      NodePtr new_root = fresh.back();
+      new_root->children()[0] = built.root_;
+      built.root_ = new_root;
+      open.push_back(new_root);
+    }
+    NodePtr right_child = nullptr;
+    for (size_t level = 0; level < full; ++level) {
+      if (right_child != nullptr) {
+        fresh[level]->children()[0] = right_child;
+      }
+      open[level] = right_child = fresh[level];
+    }
+    NodePtr node = open[full];
+    node->insertKey(node->count, std::move(value));
+    if (right_child != nullptr) {
+      node->children()[node->count] = right_child;
+    }
+    previous = node->keys() + node->count - 1;
+    fresh.clear();
+  }
+  // Every node but the open ones is full; top-down, top up each open node
+  // that is short of keys from its full left sibling.
+  for (size_t level = open.size(); level-- > 1;) {
+    NodePtr parent = open[level];
+    while (open[level - 1]->count < kMinDegree - 1) {
+      borrowFromLeft(parent, parent->count);
+    }
+  }
+  std::swap(root_, built.root_);
+}
+
+template <std::totally_ordered T, size_t NodeBytes, typename Allocator>
+bool BTree<T, NodeBytes, Allocator>::empty() const {
+  return root_ == nullptr;
+}
+
+template <std::totally_ordered T, size_t NodeBytes, typename Allocator>
+typename BTree<T, NodeBytes, Allocator>::NodePtr
+BTree<T, NodeBytes, Allocator>::createNode(bool is_leaf) {
+  if (is_leaf) {
+    Node* node = LeafTraits::allocate(leaf_alloc_, 1);
+    LeafTraits::construct(leaf_alloc_, node, true);
+    return node;
+  }
+  InnerNode* node = InnerTraits::allocate(inner_alloc_, 1);
+  InnerTraits::construct(inner_alloc_, node);
+  return node;
+}
+
+template <std::totally_ordered T, size_t NodeBytes, typename Allocator>
+void BTree<T, NodeBytes, Allocator>::destroyNode(NodePtr node) {
+  std::destroy_n(node->keys(), node->count);
+  if (node->is_leaf) {
+    LeafTraits::destroy(leaf_alloc_, node);
+    LeafTraits::deallocate(leaf_alloc_, node, 1);
+  } else {
+    auto* inner = static_cast<InnerNode*>(node);
+    InnerTraits::destroy(inner_alloc_, inner);
+    InnerTraits::deallocate(inner_alloc_, inner, 1);
+  }
+}
+
+template <std::totally_ordered T, size_t NodeBytes, typename Allocator>
+void BTree<T, NodeBytes, Allocator>::destroySubtree(NodePtr node) {
+  if (node == nullptr) {
+    return;
+  }
+  if (!node->is_leaf) {
+    for (size_t i = 0; i <= node->count; ++i) {
+      destroySubtree(node->children()[i]);
+    }
+  }
+  destroyNode(node);
+}
+
+template <std::totally_ordered T, size_t NodeBytes, typename Allocator>
+typename BTree<T, NodeBytes, Allocator>::NodePtr
+BTree<T, NodeBytes, Allocator>::copySubtree(const Node* node) {
+  NodePtr copy = createNode(node->is_leaf);
+  try {
+    for (size_t i = 0; i < node->count; ++i) {
+      copy->insertKey(i, node->keys()[i]);
+    }
+    if (!node->is_leaf) {
+      for (size_t i = 0; i <= node->count; ++i) {
+        copy->children()[i] = copySubtree(node->children()[i]);
+      }
+    }
+  } catch (...) {
+    destroySubtree(copy);
+    throw;
+  }
+  return copy;
+}
+
+template <std::totally_ordered T, size_t NodeBytes, typename Allocator>
+size_t BTree<T, NodeBytes, Allocator>::lowerBound(const Node* node,
+                                                  const T& value) {
+  const T* keys = node->keys();
+  if constexpr (std::is_arithmetic_v<T>) {
+    // Counting the smaller keys has no data-dependent branch, so the loop
+    // vectorizes and beats a binary search on a node of a few cache lines.
+    size_t index = 0;
+    for (size_t i = 0; i < node->count; ++i) {
+      index += static_cast<size_t>(keys[i] < value);
+    }
+    return index;
+  } else {
+    return std::lower_bound(keys, keys + node->count, value) - keys;
+  }
+}
+
+template <std::totally_ordered T, size_t NodeBytes, typename Allocator>
+void BTree<T, NodeBytes, Allocator>::splitChild(NodePtr parent,
+                                                size_t index) {
+  NodePtr child = parent->children()[index];
+  NodePtr sibling = createNode(child->is_leaf);
+  child->moveKeysTo(kMinDegree, *sibling);
+  if (!child->is_leaf) {
+    std::copy_n(child->children() + kMinDegree, kMinDegree,
+                sibling->children());
+  }
+  NodePtr* children = parent->children();
+  std::copy_backward(children + index + 1,
+                     children + parent->count + 1,
+                     children + parent->count + 2);
+  children[index + 1] = sibling;
+  parent->insertKey(index, std::move(child->keys()[kMinDegree - 1]));
+  child->eraseKey(kMinDegree - 1);
+}
+
+template <std::totally_ordered T, size_t NodeBytes, typename Allocator>
+typename BTree<T, NodeBytes, Allocator>::NodePtr
+BTree<T, NodeBytes, Allocator>::fillChild(NodePtr parent, size_t index) {
+  NodePtr* children = parent->children();
+  if (children[index]->count >= kMinDegree) {
+    return children[index];
+  }
+  if (index > 0 && children[index - 1]->count >= kMinDegree) {
+    borrowFromLeft(parent, index);
+  } else if (index < parent->count &&
+             children[index + 1]->count >= kMinDegree) {
+    borrowFromRight(parent, index);
+  } else if (index < parent->count) {
+    mergeChildren(parent, index);
+  } else {
+    mergeChildren(parent, --index);
+  }
+  return children[index];
+}
+
+template <std::totally_ordered T, size_t NodeBytes, typename Allocator>
+void BTree<T, NodeBytes, Allocator>::borrowFromLeft(NodePtr parent,
+                                                    size_t index) {
+  NodePtr child = parent->children()[index];
+  NodePtr left = parent->children()[index - 1];
+  T& separator = parent->keys()[index - 1];
+  child->insertKey(0, std::move(separator));
+  separator = std::move(left->keys()[left->count - 1]);
+  left->eraseKey(left->count - 1);
+  if (!child->is_leaf) {
+    NodePtr* children = child->children();
+    std::copy_backward(children, children + child->count,
+                       children + child->count + 1);
+    children[0] = left->children()[left->count + 1];
+  }
+}
+
+template <std::totally_ordered T, size_t NodeBytes, typename Allocator>
+void BTree<T, NodeBytes, Allocator>::borrowFromRight(NodePtr parent,
+                                                     size_t index) {
+  NodePtr child = parent->children()[index];
+  NodePtr right = parent->children()[index + 1];
+  T& separator = parent->keys()[index];
+  child->insertKey(child->count, std::move(separator));
+  separator = std::move(right->keys()[0]);
+  right->eraseKey(0);
+  if (!child->is_leaf) {
+    NodePtr* children = right->children();
+    child->children()[child->count] = children[0];
+    std::copy(children + 1, children + right->count + 2, children);
+  }
+}
+
+template <std::totally_ordered T, size_t NodeBytes, typename Allocator>
+void BTree<T, NodeBytes, Allocator>::mergeChildren(NodePtr parent,
+                                                   size_t index) {
+  NodePtr* children = parent->children();
+  NodePtr left = children[index];
+  NodePtr right = children[index + 1];
+  left->insertKey(left->count, std::move(parent->keys()[index]));
+  parent->eraseKey(index);
+  std::copy(children + index + 2, children + parent->count + 2,
+            children + index + 1);
+  if (!left->is_leaf) {
+    std::copy_n(right->children(), right->count + 1,
+                left->children() + left->count);
+  }
+  right->moveKeysTo(0, *left);
+  destroyNode(right);
+}
+
+template <std::totally_ordered T, size_t NodeBytes, typename Allocator>
+T BTree<T, NodeBytes, Allocator>::extractMax(NodePtr node) {
+  while (!node->is_leaf) {
+    node = fillChild(node, node->count);
+  }
+  T value(std::move(node->keys()[node->count - 1]));
+  node->eraseKey(node->count - 1);
+  return value;
+}
+
+template <std::totally_ordered T, size_t NodeBytes, typename Allocator>
+T BTree<T, NodeBytes, Allocator>::extractMin(NodePtr node) {
+  while (!node->is_leaf) {
+    node = fillChild(node, 0);
+  }
+  T value(std::move(node->keys()[0]));
+  node->eraseKey(0);
+  return value;
+}
+
+template <std::totally_ordered T, size_t NodeBytes, typename Allocator>
+void BTree<T, NodeBytes, Allocator>::shrinkRoot() {
+  if (root_ == nullptr || root_->count != 0) {
+    return;
+  }
+  NodePtr old_root = root_;
+  root_ = root_->is_leaf ? nullptr : root_->children()[0];
+  destroyNode(old_root);
+}
+
+namespace pmr {
+
+/// <b> BTree whose nodes come from a memory_resource
+template <std::totally_ordered T, size_t NodeBytes = 256>
+using BTree =
+    ::BTree<T, NodeBytes, std::pmr::polymorphic_allocator<T>>;
+
+}  // namespace pmr
@@ -0,0 +1,127 @@
+// BTree against the AVL BinaryTree on random 64-bit keys: insert
+// throughput, bulkLoad time, lookup latency (each query depends on the
+// previous answer, so the misses of one lookup cannot overlap the next)
+// and the node bytes each tree requests from its allocator per key.
+//
+//   g++ -std=c++20 -O2 BTree_bench.cpp
+//   ./a.out [keys] [lookups]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "BTree.cpp"
+#include "Tree.cpp"
+
+namespace {
+
+size_t live_bytes = 0;
+
+// std::allocator that keeps live_bytes up to date.
+template <typename T>
+struct CountingAllocator {
+  using value_type = T;
+
+  CountingAllocator() = default;
+  template <typename U>
+  CountingAllocator(const CountingAllocator<U>&) {}
+
+  T* allocate(size_t count) {
+    live_bytes += count * sizeof(T);
+    return std::allocator<T>().allocate(count);
+  }
+
+  void deallocate(T* pointer, size_t count) {
+    live_bytes -= count * sizeof(T);
+    std::allocator<T>().deallocate(pointer, count);
+  }
+
+  template <typename U>
+  bool operator==(const CountingAllocator<U>&) const {
+    return true;
+  }
+};
+
+template <typename Func>
+double seconds(Func func) {
+  const auto kStart = std::chrono::steady_clock::now();
+  func();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       kStart)
+      .count();
+}
+
+template <typename Tree>
+void bench(const char* name, const std::vector<uint64_t>& keys,
+           const std::vector<uint64_t>& queries) {
+  std::printf("%s\n", name);
+  const size_t kBaseBytes = live_bytes;
+  {
+    Tree tree;
+    double time = seconds([&] {
+      for (uint64_t key : keys) {
+        tree.insert(key);
+      }
+    });
+    std::printf("  insert         %8.3f Minserts/s\n",
+                keys.size() / time / 1e6);
+    std::printf("  node memory    %8.1f bytes/key\n",
+                static_cast<double>(live_bytes - kBaseBytes) / keys.size());
+
+    size_t found = 0;
+    time = seconds([&] {
+      for (size_t i = 0; i < queries.size(); ++i) {
+        // found is 0 or 1 more each step, so the next query cannot be
+        // chosen until this one is answered.
+        found += tree.hasElement(queries[(i + found) % queries.size()]);
+      }
+    });
+    std::printf("  lookup         %8.1f ns  (%zu hits)\n",
+                time * 1e9 / queries.size(), found);
+  }
+  if constexpr (requires(Tree tree) {
+                  tree.bulkLoad(keys.begin(), keys.end());
+                }) {
+    std::vector<uint64_t> sorted = keys;
+    std::sort(sorted.begin(), sorted.end());
+    Tree tree;
+    const double kTime =
+        seconds([&] { tree.bulkLoad(sorted.begin(), sorted.end()); });
+    std::printf("  bulkLoad       %8.3f Mkeys/s, %.1f bytes/key\n",
+                sorted.size() / kTime / 1e6,
+                static_cast<double>(live_bytes - kBaseBytes) / sorted.size());
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t kKeys =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 4'000'000;
+  const size_t kLookups =
+      argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2'000'000;
+
+  // Distinct keys; the queries hit about half of the time.
+  std::mt19937_64 rng(1);
+  std::vector<uint64_t> keys(kKeys);
+  for (size_t i = 0; i < kKeys; ++i) {
+    keys[i] = 2 * i;
+  }
+  std::shuffle(keys.begin(), keys.end(), rng);
+  std::vector<uint64_t> queries(kLookups);
+  for (uint64_t& query : queries) {
+    query = rng() % (2 * kKeys);
+  }
+
+  std::printf("%zu keys, %zu lookups\n", kKeys, kLookups);
+  using Alloc = CountingAllocator<uint64_t>;
+  bench<BinaryTree<uint64_t, Alloc>>("BinaryTree (AVL)", keys, queries);
+  bench<BTree<uint64_t, 256, Alloc>>("BTree, 256-byte nodes", keys, queries);
+  bench<BTree<uint64_t, 1024, Alloc>>("BTree, 1024-byte nodes", keys,
+                                      queries);
+}
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <utility>
+
+#include "EpochReclaimer.cpp"
+
+// Sorted set on a singly linked list that any number of threads may use
+// at once without locks (Harris's algorithm, in Michael's formulation).
+// Erasing first marks the low bit of the node's next pointer, which
+// freezes the node, and then unlinks it; any thread that runs into a
+// marked node while searching helps unlink it. Unlinked nodes are handed
+// to EpochReclaimer, and every operation runs inside an epoch guard, so a
+// node is never freed while another thread may be reading it.
+template <typename T, typename Compare = std::less<T>>
+class ConcurrentList {
+ public:
+  ConcurrentList() = default;
+  explicit ConcurrentList(const Compare& comp) : comp_(comp) {}
+  ConcurrentList(const ConcurrentList&) = delete;
+  ConcurrentList& operator=(const ConcurrentList&) = delete;
+
+  // No other thread may use the list any more.
+  ~ConcurrentList() {
+    uintptr_t link = head_.next.load(std::memory_order_relaxed);
+    while (Node* node = pointer(link)) {
+      link = node->next.load(std::memory_order_relaxed);
+      delete node;
+    }
+  }
+
+  // Returns false if an equivalent value is already present.
+  bool insert(const T& value) { return emplace(value); }
+  bool insert(T&& value) { return emplace(std::move(value)); }
+
+  template <typename... Args>
+  bool emplace(Args&&... args) {
+    auto* node = new Node(std::forward<Args>(args)...);
+    EpochReclaimer::Guard guard;
+    while (true) {
+      Position position = find(node->value);
+      if (position.found) {
+        delete node;
+        return false;
+      }
+      uintptr_t expected = link_of(position.current);
+      node->next.store(expected, std::memory_order_relaxed);
+      if (position.prev->next.compare_exchange_strong(
+              expected, link_of(node), std::memory_order_release,
+              std::memory_order_relaxed)) {
+        return true;
+      }
+    }
+  }
+
+  // Returns false if no equivalent value was present. Of several threads
+  // erasing one value, exactly one succeeds.
+  bool erase(const T& value) {
+    EpochReclaimer::Guard guard;
+    while (true) {
+      Position position = find(value);
+      if (!position.found) {
+        return false;
+      }
+      Node* node = position.current;
+      uintptr_t next = node->next.load(std::memory_order_acquire);
+      if (is_marked(next)) {
+        continue;
+      }
+      if (!node->next.compare_exchange_strong(next, next | kMark,
+                                              std::memory_order_acq_rel)) {
+        continue;
+      }
+      uintptr_t expected = link_of(node);
+      if (position.prev->next.compare_exchange_strong(
+              expected, next, std::memory_order_release,
+              std::memory_order_relaxed)) {
+        retire(node);
+      } else {
+        find(value);
+      }
+      return true;
+    }
+  }
+
+  // Wait-free: walks past marked nodes without unlinking them.
+  bool contains(const T& value) const {
+    EpochReclaimer::Guard guard;
+    Node* node = pointer(head_.next.load(std::memory_order_acquire));
+    while (node != nullptr && comp_(node->value, value)) {
+      node = pointer(node->next.load(std::memory_order_acquire));
+    }
+    return node != nullptr && !comp_(value, node->value) &&
+           !is_marked(node->next.load(std::memory_order_acquire));
+  }
+
+  // Calls func on every value in order. Values inserted or erased during
+  // the walk may or may not be seen.
+  template <typename Func>
+  void for_each(Func func) const {
+    EpochReclaimer::Guard guard;
+    for (Node* node = pointer(head_.next.load(std::memory_order_acquire));
+         node != nullptr;) {
+      const uintptr_t kNext = node->next.load(std::memory_order_acquire);
+      if (!is_marked(kNext)) {
+        func(static_cast<const T&>(node->value));
+      }
+      node = pointer(kNext);
+    }
+  }
+
+  [[nodiscard]] bool empty() const {
+    bool empty = true;
+    for_each([&empty](const T&) { empty = false; });
+    return empty;
+  }
+
+ private:
+  struct BaseNode {
+    std::atomic<uintptr_t> next{0};
+  };
+
+  struct Node : BaseNode {
+    T value;
+    template <typename... Args>
+    explicit Node(Args&&... args) : value(std::forward<Args>(args)...) {}
+  };
+
+  struct Position {
+    BaseNode* prev;
+    Node* current;
+    bool found;
+  };
+
+  static constexpr uintptr_t kMark = 1;
+  static_assert(alignof(Node) > 1, "the mark needs a free low pointer bit");
+
+  static Node* pointer(uintptr_t link) {
+    return reinterpret_cast<Node*>(link & ~kMark);
+  }
+  static uintptr_t link_of(Node* node) {
+    return reinterpret_cast<uintptr_t>(node);
+  }
+  static bool is_marked(uintptr_t link) { return (link & kMark) != 0; }
+
+  static void retire(Node* node) {
+    EpochReclaimer::retire(node,
+                           [](void* node) { delete static_cast<Node*>(node); });
+  }
+
+  // Returns the first node not less than value and its predecessor,
+  // unlinking every marked node on the way. Must run inside a guard.
+  Position find(const T& value) {
+    while (true) {
+      BaseNode* prev = &head_;
+      Node* current = pointer(prev->next.load(std::memory_order_acquire));
+      bool restart = false;
+      while (current != nullptr) {
+        const uintptr_t kNext = current->next.load(std::memory_order_acquire);
+        if (is_marked(kNext)) {
+          uintptr_t expected = link_of(current);
+          if (!prev->next.compare_exchange_strong(
+                  expected, kNext & ~kMark, std::memory_order_acq_rel,
+                  std::memory_order_relaxed)) {
+            restart = true;
+            break;
+          }
+          retire(current);
+          current = pointer(kNext);
+          continue;
+        }
+        if (!comp_(current->value, value)) {
+          return {prev, current, !comp_(value, current->value)};
+        }
+        prev = current;
+        current = pointer(kNext);
+      }
+      if (!restart) {
+        return {prev, nullptr, false};
+      }
+    }
+  }
+
+  BaseNode head_;
+  [[no_unique_address]] Compare comp_;
+};
@@ -0,0 +1,133 @@
+// Runs a mix of lookups, inserts and erases on a sorted set shared by 1 to
+// N threads, once on ConcurrentList and once on a List behind a global
+// mutex, and prints the total throughput for each thread count.
+//
+//   g++ -std=c++20 -O2 -pthread ConcurrentList_bench.cpp
+//   ./a.out [max_threads] [ops_per_thread] [key_range] [lookup_percent]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "ConcurrentList.cpp"
+#include "List.cpp"
+
+namespace {
+
+struct Config {
+  size_t ops_per_thread;
+  uint64_t key_range;
+  unsigned lookup_percent;
+};
+
+// Sorted List guarded by one mutex, the setup ConcurrentList replaces.
+class LockedList {
+ public:
+  bool insert(uint64_t key) {
+    std::lock_guard lock(mutex_);
+    auto pos = lowerBound(key);
+    if (pos != list_.end() && *pos == key) {
+      return false;
+    }
+    list_.emplace(pos, key);
+    return true;
+  }
+  bool erase(uint64_t key) {
+    std::lock_guard lock(mutex_);
+    auto pos = lowerBound(key);
+    if (pos == list_.end() || *pos != key) {
+      return false;
+    }
+    list_.erase(pos);
+    return true;
+  }
+  bool contains(uint64_t key) {
+    std::lock_guard lock(mutex_);
+    auto pos = lowerBound(key);
+    return pos != list_.end() && *pos == key;
+  }
+
+ private:
+  List<uint64_t>::iterator lowerBound(uint64_t key) {
+    auto pos = list_.begin();
+    while (pos != list_.end() && *pos < key) {
+      ++pos;
+    }
+    return pos;
+  }
+
+  std::mutex mutex_;
+  List<uint64_t> list_;
+};
+
+// Keeps the results of the operations live, so that the compiler can't drop
+// the side-effect-free lookups of LockedList.
+std::atomic<uint64_t> successes{0};
+
+template <typename Set>
+double run(size_t threads, const Config& config) {
+  Set set;
+  // Start half full, so that inserts and erases both mostly succeed.
+  for (uint64_t key = 0; key < config.key_range; key += 2) {
+    set.insert(key);
+  }
+  std::vector<std::thread> workers;
+  const auto kStart = std::chrono::steady_clock::now();
+  for (size_t t = 0; t < threads; ++t) {
+    workers.emplace_back([&set, &config, t] {
+      std::mt19937_64 rng(t + 1);
+      uint64_t local_successes = 0;
+      for (size_t i = 0; i < config.ops_per_thread; ++i) {
+        const uint64_t kKey = rng() % config.key_range;
+        const unsigned kDice = rng() % 100;
+        if (kDice < config.lookup_percent) {
+          local_successes += set.contains(kKey);
+        } else if (kDice % 2 == 0) {
+          local_successes += set.insert(kKey);
+        } else {
+          local_successes += set.erase(kKey);
+        }
+      }
+      successes.fetch_add(local_successes, std::memory_order_relaxed);
+    });
+  }
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  const double kSeconds = std::chrono::duration<double>(
+                              std::chrono::steady_clock::now() - kStart)
+                              .count();
+  return threads * config.ops_per_thread / kSeconds / 1e6;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t kMaxThreads =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10)
+               : std::max<size_t>(4, std::thread::hardware_concurrency());
+  Config config;
+  config.ops_per_thread =
+      argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 200'000;
+  config.key_range = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 1024;
+  config.lookup_percent =
+      argc > 4 ? static_cast<unsigned>(std::atoi(argv[4])) : 80;
+  std::printf("%zu ops/thread, keys in [0, %llu), %u%% lookups\n",
+              config.ops_per_thread,
+              static_cast<unsigned long long>(config.key_range),
+              config.lookup_percent);
+  std::printf("%8s %18s %18s\n", "threads", "ConcurrentList", "mutex + List");
+  for (size_t threads = 1; threads <= kMaxThreads; threads *= 2) {
+    const double kLockFree = run<ConcurrentList<uint64_t>>(threads, config);
+    const double kLocked = run<LockedList>(threads, config);
+    std::printf("%8zu %12.2f Mop/s %12.2f Mop/s\n", threads, kLockFree,
+                kLocked);
+  }
+}
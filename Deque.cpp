@@ -1,95 +1,137 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <functional>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <numeric>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
-template <typename T, typename Allocator = std::allocator<T>>
+// Default array size: as many elements as fit in 4 KiB, rounded down to a
+// power of two so that index math compiles to shifts and masks.
+template <typename T>
+inline constexpr size_t kDequeArraySize =
+    std::bit_floor(std::max<size_t>(4096 / sizeof(T), 16));
+
+// How the Deque map grows and shrinks. A custom policy is any type with
+// the same constants.
+struct DequeGrowthPolicy {
+  // The map is multiplied by this factor when an end runs out of slots.
+  static constexpr size_t kGrowthFactor = 3;
+  // Emptied arrays kept allocated past each end for the next pushes.
+  static constexpr size_t kMaxSpareArrays = 1;
+  // Arrays emptied past kMaxSpareArrays are recycled to the other end as
+  // long as it holds fewer spares than this, so a FIFO queue of bounded
+  // size stops calling the allocator.
+  static constexpr size_t kMaxCachedArrays = 4;
+  // Pops shrink the map only once it is this many times larger than the
+  // arrays in use; must exceed kGrowthFactor so that a grow is not
+  // immediately followed by a shrink.
+  static constexpr size_t kShrinkFactor = 8;
+};
+
+template <typename T, typename Allocator = std::allocator<T>,
+          size_t ArraySize = kDequeArraySize<T>,
+          typename GrowthPolicy = DequeGrowthPolicy>
 class Deque {
+  static_assert(std::has_single_bit(ArraySize) && ArraySize >= 2,
+                "Deque array size must be a power of two");
+  static_assert(GrowthPolicy::kGrowthFactor >= 2,
+                "Deque map must at least double when it grows");
+  static_assert(GrowthPolicy::kShrinkFactor > GrowthPolicy::kGrowthFactor,
+                "Deque shrink factor must exceed the growth factor");
+  static_assert(GrowthPolicy::kMaxCachedArrays >= GrowthPolicy::kMaxSpareArrays,
+                "Deque must cache at least the spare arrays");
+
+  using allocator_traits = std::allocator_traits<Allocator>;
+  using allocator = typename allocator_traits::template rebind_alloc<T>;
+  using array_traits = std::allocator_traits<allocator>;
+  // The map is allocated through the same allocator as the arrays.
+  using map_allocator = typename allocator_traits::template rebind_alloc<T*>;
+  using Map = std::vector<T*, map_allocator>;
+
+  static constexpr bool kPropagateOnCopy =
+      allocator_traits::propagate_on_container_copy_assignment::value;
+  static constexpr bool kPropagateOnMove =
+      allocator_traits::propagate_on_container_move_assignment::value;
+
  public:
   Deque() = default;
 
   explicit Deque(const Allocator& alloc) : alloc_(alloc) {}
 
-  Deque(const Deque& other) {
-    alloc_ =
-        allocator_traits::select_on_container_copy_construction(other.alloc_);
-    auto begin = other.begin();
-    auto end = other.end();
-    for (auto iter = begin; iter != end; ++iter) {
-      try {
-        emplace_back(*iter);
-      } catch (...) {
-        while (size_ != 0) {
-          pop_back();
-        }
-        dealloc();
-        throw;
-      }
-    }
-  }
+  Deque(const Deque& other)
+      : Deque(other, allocator_traits::select_on_container_copy_construction(
+                         other.alloc_)) {}
 
-  explicit Deque(size_t count, const Allocator& alloc = Allocator()) {
-    alloc_ = alloc;
-    for (size_t it = 0; it < count; ++it) {
-      try {
-        emplace_back();
-      } catch (...) {
-        while (size_ != 0) {
-          pop_back();
-        }
-        dealloc();
-        throw;
+  Deque(const Deque& other, const Allocator& alloc) : alloc_(alloc) {
+    try {
+      if (other.size() != 0) {
+        reserve_back(other.size());
       }
+      other.for_each_segment(
+          [this](const T* first, const T* last) { append_range(first, last); });
+    } catch (...) {
+      while (size_ != 0) {
+        pop_back();
+      }
+      dealloc();
+      throw;
     }
   }
 
-  Deque(size_t count, const T& value, const Allocator& alloc = Allocator()) {
-    alloc_ = alloc;
-    for (size_t it = 0; it < count; ++it) {
-      try {
-        emplace_back(value);
-      } catch (...) {
-        while (size_ != 0) {
-          pop_back();
-        }
-        dealloc();
-        throw;
-      }
+  explicit Deque(size_t count, const Allocator& alloc = Allocator())
+      : alloc_(alloc) {
+    try {
+      append_blocks(count, [this](T* first, size_t count) {
+        construct_n(first, count);
+      });
+    } catch (...) {
+      dealloc();
+      throw;
     }
   }
 
-  Deque(Deque&& other) noexcept {
-    body_ = other.body_;
-    first_in_array_index_ = other.first_in_array_index_;
-    last_in_array_index_ = other.last_in_array_index_;
-    first_array_index_ = other.first_array_index_;
-    last_array_index_ = other.last_array_index_;
-    size_ = other.size_;
-    capacity_of_arr_ = other.capacity_of_arr_;
-    alloc_ = other.alloc_;
-    other.body_.clear();
-    reset(other.first_in_array_index_);
-    reset(other.last_in_array_index_);
-    reset(other.first_array_index_);
-    reset(other.last_array_index_);
-    reset(other.size_);
-    reset(other.capacity_of_arr_);
+  Deque(size_t count, const T& value, const Allocator& alloc = Allocator())
+      : alloc_(alloc) {
+    try {
+      append_blocks(count, [this, &value](T* first, size_t count) {
+        construct_n(first, count, value);
+      });
+    } catch (...) {
+      dealloc();
+      throw;
+    }
   }
 
-  Deque(std::initializer_list<T> init, const Allocator& alloc = Allocator()) {
-    alloc_ = alloc;
-    for (const auto& iter : init) {
-      try {
-        emplace_back(iter);
-      } catch (...) {
-        while (size_ != 0) {
-          pop_back();
-        }
-        dealloc();
-        throw;
+  template <typename InputIt,
+            typename = std::enable_if_t<!std::is_integral_v<InputIt>>>
+  Deque(InputIt first, InputIt last, const Allocator& alloc = Allocator())
+      : alloc_(alloc) {
+    try {
+      append_range(first, last);
+    } catch (...) {
+      while (size_ != 0) {
+        pop_back();
       }
+      dealloc();
+      throw;
     }
   }
 
+  Deque(Deque&& other) noexcept : alloc_(other.alloc_) {
+    take_storage(other);
+  }
+
+  Deque(std::initializer_list<T> init, const Allocator& alloc = Allocator())
+      : Deque(init.begin(), init.end(), alloc) {}
+
   ~Deque() {
     while (size_ != 0) {
       pop_back();
@@ -101,26 +143,23 @@ class Deque {
     if (this == &other) {
       return *this;
     }
-    Deque tmp(other);
-    if constexpr (allocator_traits::propagate_on_container_copy_assignment::
-                      value) {
-      alloc_ = other.alloc_;
-    }
+    // The copy is built with the allocator that will own it.
+    Deque tmp(other, kPropagateOnCopy ? other.alloc_ : alloc_);
     while (size() != 0) {
       pop_back();
     }
     dealloc();
-    std::swap(body_, tmp.body_);
-    std::swap(first_in_array_index_, tmp.first_in_array_index_);
-    std::swap(first_array_index_, tmp.first_array_index_);
-    std::swap(last_in_array_index_, tmp.last_in_array_index_);
-    std::swap(last_array_index_, tmp.last_array_index_);
-    std::swap(size_, tmp.size_);
-    std::swap(capacity_of_arr_, tmp.capacity_of_arr_);
+    if constexpr (kPropagateOnCopy) {
+      alloc_ = other.alloc_;
+    }
+    take_storage(tmp);
     return *this;
   }
 
-  Deque& operator=(Deque&& other) noexcept {
+  // Takes over the arrays of other unless the allocators differ and do not
+  // propagate; then the elements are moved one by one.
+  Deque& operator=(Deque&& other) noexcept(
+      kPropagateOnMove || allocator_traits::is_always_equal::value) {
     if (this == &other) {
       return *this;
     }
@@ -128,21 +167,14 @@ class Deque {
       pop_back();
     }
     dealloc();
-    body_ = std::move(other.body_);
-    first_in_array_index_ = other.first_in_array_index_;
-    last_in_array_index_ = other.last_in_array_index_;
-    first_array_index_ = other.first_array_index_;
-    last_array_index_ = other.last_array_index_;
-    size_ = other.size_;
-    capacity_of_arr_ = other.capacity_of_arr_;
-    alloc_ = std::move(other.alloc_);
-    other.body_.clear();
-    reset(other.first_in_array_index_);
-    reset(other.last_in_array_index_);
-    reset(other.first_array_index_);
-    reset(other.last_array_index_);
-    reset(other.size_);
-    reset(other.capacity_of_arr_);
+    if constexpr (kPropagateOnMove) {
+      alloc_ = std::move(other.alloc_);
+    } else if (alloc_ != other.alloc_) {
+      append_range(std::make_move_iterator(other.begin()),
+                   std::make_move_iterator(other.end()));
+      return *this;
+    }
+    take_storage(other);
     return *this;
   }
 
@@ -156,111 +188,60 @@ class Deque {
 
   T& at(const size_t& index) {
     check_index(index);
-    return body_[(index + first_in_array_index_) / kArraySize +
-                 first_array_index_]
-                [(index + first_in_array_index_) % kArraySize];
+    return (*this)[index];
   }
 
   [[nodiscard]] const T& at(const size_t& index) const {
     check_index(index);
-    return body_[(index + first_in_array_index_) / kArraySize +
-                 first_array_index_]
-                [(index + first_in_array_index_) % kArraySize];
+    return (*this)[index];
   }
 
   T& operator[](const size_t& index) {
-    return body_[(index + first_in_array_index_) / kArraySize +
-                 first_array_index_]
-                [(index + first_in_array_index_) % kArraySize];
+    const size_t kPosition = index + first_in_array_index_;
+    return body_[(kPosition >> kArrayShift) + first_array_index_]
+                [kPosition & kArrayMask];
   }
 
   const T& operator[](const size_t& index) const {
-    return body_[(index + first_in_array_index_) / kArraySize +
-                 first_array_index_]
-                [(index + first_in_array_index_) % kArraySize];
+    const size_t kPosition = index + first_in_array_index_;
+    return body_[(kPosition >> kArrayShift) + first_array_index_]
+                [kPosition & kArrayMask];
   }
 
   template <typename... Args>
   void emplace_back(Args&&... args) {
-    if (capacity() != 0) {
-      if (back_increase_capacity_condition()) {
-        increase_capacity();
-      }
-      if (last_in_array_index_ + 1 == kArraySize) {
-        if (last_array_index_ + 1 == body_.size()) {
-          increase_capacity();
-        }
-        last_array_index_++;
-        last_in_array_index_ = 0;
-      } else {
-        last_in_array_index_++;
-      }
-      try {
-        array_traits::construct(alloc_, last_element(),
-                                std::forward<Args>(args)...);
-      } catch (...) {
-        if (last_in_array_index_ == 0) {
-          last_array_index_--;
-          last_in_array_index_ = kArraySize - 1;
-        } else {
-          last_in_array_index_--;
-        }
-        throw;
+    if (capacity() == 0) {
+      initial_allocate();
+    }
+    if (last_in_array_index_ + 1 == kArraySize) {
+      if (last_array_index_ + 1 == body_.size()) {
+        make_room(0, 1);
       }
-      ++size_;
+      allocate_array(last_array_index_ + 1);
+      last_array_index_++;
+      last_in_array_index_ = 0;
     } else {
-      initial_allocate();
-      try {
-        array_traits::construct(alloc_, last_element(),
-                                std::forward<Args>(args)...);
-      } catch (...) {
-        dealloc();
-        throw;
+      last_in_array_index_++;
+    }
+    try {
+      array_traits::construct(alloc_, last_element(),
+                              std::forward<Args>(args)...);
+    } catch (...) {
+      if (last_in_array_index_ == 0) {
+        last_array_index_--;
+        last_in_array_index_ = kArraySize - 1;
+      } else {
+        last_in_array_index_--;
       }
-      ++size_;
+      throw;
     }
+    ++size_;
   }
 
   void push_back(const T& value) { emplace_back(value); }
 
   void push_back(T&& value) { emplace_back(std::move(value)); }
 
-  void decrease_capacity() {
-    auto prev_array_size =
-        last_array_index_ * kArraySize + last_in_array_index_ + 1;
-    if (prev_array_size <= size_ / 4) {
-      auto new_capacity = size_ / 2 + 1;
-      if (new_capacity >= capacity_of_arr_ / 2) {
-        new_capacity = capacity_of_arr_ / 2;
-      }
-      if (new_capacity >= kArraySize) {
-        std::vector<T*> new_body(new_capacity, nullptr);
-        for (size_t i = 0; i < new_capacity; ++i) {
-          new_body[i] = array_traits::allocate(alloc_, kArraySize);
-        }
-        size_t new_first_array_index = (new_capacity - size_) / 2;
-        size_t new_last_array_index = new_first_array_index + size_ - 1;
-        size_t new_first_in_array_index = kArraySize - size_ % kArraySize;
-        size_t new_last_in_array_index = kArraySize - 1;
-        for (size_t i = new_first_array_index, j = first_array_index_;
-             i <= new_last_array_index; ++i, ++j) {
-          for (size_t k = 0; k < kArraySize; ++k) {
-            array_traits::construct(alloc_, &new_body[i][k],
-                                    std::move(body_[j][k]));
-            array_traits::destroy(alloc_, &body_[j][k]);
-          }
-          array_traits::deallocate(alloc_, body_[j], kArraySize);
-        }
-        body_.swap(new_body);
-        capacity_of_arr_ = new_capacity;
-        first_array_index_ = new_first_array_index;
-        last_array_index_ = new_last_array_index;
-        first_in_array_index_ = new_first_in_array_index;
-        last_in_array_index_ = new_last_in_array_index;
-      }
-    }
-  }
-
   void pop_back() {
     if (empty()) {
       throw std::runtime_error("Try to pop from an empty deque");
@@ -268,68 +249,145 @@ class Deque {
 
     array_traits::destroy(alloc_,
                           &body_[last_array_index_][last_in_array_index_]);
-    if (first_in_array_index_ != last_in_array_index_ ||
-        first_array_index_ != last_array_index_) {
-      if (last_in_array_index_ == 0) {
-        last_in_array_index_ = kArraySize - 1;
-        last_array_index_ -= 1;
-      } else {
-        --last_in_array_index_;
-      }
+    --size_;
+    if (size_ == 0) {
+      set_indexes_in_array();
+    } else if (last_in_array_index_ == 0) {
+      last_in_array_index_ = kArraySize - 1;
+      last_array_index_ -= 1;
+      release_array(last_array_index_ + GrowthPolicy::kMaxSpareArrays + 1);
+      decrease_capacity();
     } else {
-      if (last_array_index_ > 0) {
-        decrease_capacity();
-      }
+      --last_in_array_index_;
     }
-
-    --size_;
   }
 
   template <typename... Args>
   void emplace_front(Args&&... args) {
-    if (capacity() != 0) {
-      if (front_increase_capacity_condition()) {
-        increase_capacity();
+    if (capacity() == 0) {
+      initial_allocate();
+    }
+    if (first_in_array_index_ == 0) {
+      if (first_array_index_ == 0) {
+        make_room(1, 0);
       }
-      if (first_in_array_index_ == 0) {
-        if (first_array_index_ == 0) {
-          increase_capacity();
-        }
-        first_array_index_--;
-        first_in_array_index_ = kArraySize - 1;
+      allocate_array(first_array_index_ - 1);
+      first_array_index_--;
+      first_in_array_index_ = kArraySize - 1;
+    } else {
+      first_in_array_index_--;
+    }
+    try {
+      array_traits::construct(alloc_, first_element(),
+                              std::forward<Args>(args)...);
+    } catch (...) {
+      if (first_in_array_index_ == kArraySize - 1) {
+        first_array_index_++;
+        first_in_array_index_ = 0;
       } else {
-        first_in_array_index_--;
+        first_in_array_index_++;
       }
+      throw;
+    }
+    ++size_;
+  }
+
+  void push_front(const T& value) { emplace_front(value); }
+
+  void push_front(T&& value) { emplace_front(std::move(value)); }
 
+  // Appends [first, last) to the back. For forward iterators the map and
+  // arrays are reserved once and the elements are built array by array;
+  // if a constructor throws, the deque is left unchanged.
+  template <typename InputIt>
+  void append_range(InputIt first, InputIt last) {
+    using category = typename std::iterator_traits<InputIt>::iterator_category;
+    if constexpr (std::is_base_of_v<std::forward_iterator_tag, category>) {
+      append_blocks(static_cast<size_t>(std::distance(first, last)),
+                    [this, &first](T* destination, size_t count) {
+                      first = copy_n(first, count, destination);
+                    });
+    } else {
+      const size_t kOldSize = size_;
       try {
-        array_traits::construct(alloc_, first_element(),
-                                std::forward<Args>(args)...);
+        for (; first != last; ++first) {
+          emplace_back(*first);
+        }
       } catch (...) {
-        if (first_in_array_index_ == kArraySize - 1) {
-          first_array_index_++;
-          first_in_array_index_ = 0;
-        } else {
-          first_in_array_index_++;
+        while (size_ != kOldSize) {
+          pop_back();
         }
         throw;
       }
-      ++size_;
+    }
+  }
+
+  template <typename Range>
+  void append_range(Range&& range) {
+    append_range(std::begin(range), std::end(range));
+  }
+
+  // Prepends [first, last) so that *first becomes the new front.
+  template <typename InputIt>
+  void prepend_range(InputIt first, InputIt last) {
+    using category = typename std::iterator_traits<InputIt>::iterator_category;
+    if constexpr (std::is_base_of_v<std::forward_iterator_tag, category>) {
+      prepend_blocks(static_cast<size_t>(std::distance(first, last)),
+                     [this, &first](T* destination, size_t count) {
+                       first = copy_n(first, count, destination);
+                     });
     } else {
+      Deque tmp(first, last, alloc_);
+      prepend_range(std::make_move_iterator(tmp.begin()),
+                    std::make_move_iterator(tmp.end()));
+    }
+  }
+
+  template <typename Range>
+  void prepend_range(Range&& range) {
+    prepend_range(std::begin(range), std::end(range));
+  }
+
+  // Makes sure that the next count pushes to the back (or to the front)
+  // neither grow the map nor allocate arrays.
+  void reserve_back(size_t count) {
+    if (capacity() == 0) {
       initial_allocate();
-      try {
-        array_traits::construct(alloc_, first_element(),
-                                std::forward<Args>(args)...);
-      } catch (...) {
-        dealloc();
-        throw;
-      }
-      ++size_;
+    }
+    const size_t kBackArrays =
+        ((last_position() + count) >> kArrayShift) - last_array_index_;
+    if (last_array_index_ + kBackArrays >= body_.size()) {
+      make_room(0, kBackArrays);
+    }
+    const size_t kLastArray = (last_position() + count) >> kArrayShift;
+    for (size_t i = last_array_index_ + 1; i <= kLastArray; ++i) {
+      allocate_array(i);
     }
   }
 
-  void push_front(const T& value) { emplace_front(value); }
+  void reserve_front(size_t count) {
+    if (capacity() == 0) {
+      initial_allocate();
+    }
+    if (first_position() < count) {
+      make_room((count - first_in_array_index_ + kArrayMask) >> kArrayShift,
+                0);
+    }
+    const size_t kFirstArray = (first_position() - count) >> kArrayShift;
+    for (size_t i = kFirstArray; i < first_array_index_; ++i) {
+      allocate_array(i);
+    }
+  }
 
-  void push_front(T&& value) { emplace_front(std::move(value)); }
+  // Frees every array that holds no elements and shrinks the map to the
+  // arrays in use. Elements are not moved.
+  void shrink_to_fit() {
+    if (size_ == 0) {
+      dealloc();
+      return;
+    }
+    reallocate_map(last_array_index_ - first_array_index_ + 1, 0);
+  }
 
   void pop_front() {
     if (empty()) {
@@ -338,21 +396,19 @@ class Deque {
 
     array_traits::destroy(alloc_,
                           &body_[first_array_index_][first_in_array_index_]);
-    if (first_in_array_index_ != last_in_array_index_ ||
-        first_array_index_ != last_array_index_) {
-      if (first_in_array_index_ == kArraySize - 1) {
-        first_in_array_index_ = 0;
-        first_array_index_ += 1;
-      } else {
-        ++first_in_array_index_;
+    --size_;
+    if (size_ == 0) {
+      set_indexes_in_array();
+    } else if (first_in_array_index_ == kArraySize - 1) {
+      first_in_array_index_ = 0;
+      first_array_index_ += 1;
+      if (first_array_index_ > GrowthPolicy::kMaxSpareArrays) {
+        release_array(first_array_index_ - GrowthPolicy::kMaxSpareArrays - 1);
       }
+      decrease_capacity();
     } else {
-      if (first_array_index_ > 0) {
-        decrease_capacity();
-      }
+      ++first_in_array_index_;
     }
-
-    --size_;
   }
 
   template <bool IsConst>
@@ -363,15 +419,22 @@ class Deque {
     using iterator_category = std::random_access_iterator_tag;
     using reference = value_type&;
     using diff = std::ptrdiff_t;
+    using difference_type = diff;
 
     Iterator() : body_(nullptr), index_of_array_(0), index_in_array_(0) {}
 
     Iterator(size_t index_of_array, size_t index_in_array,
-             const std::vector<T*>* body)
+             const Map* body)
         : body_(body),
           index_of_array_(index_of_array),
           index_in_array_(index_in_array) {}
 
+    operator Iterator<true>() const
+      requires(!IsConst)
+    {
+      return Iterator<true>(index_of_array_, index_in_array_, body_);
+    }
+
     Iterator<IsConst>& operator++() {
       if (index_in_array_ == kArraySize - 1) {
         index_in_array_ = 0;
@@ -405,21 +468,12 @@ class Deque {
     }
 
     Iterator<IsConst>& operator+=(diff n) {
-      if (n >= 0) {
-        size_t total_index = index_of_array_ * kArraySize + index_in_array_ + n;
-        index_of_array_ = total_index / kArraySize;
-        index_in_array_ = total_index % kArraySize;
-      } else {
-        diff neg_n = -n;
-        if (index_in_array_ >= static_cast<size_t>(neg_n)) {
-          index_in_array_ -= static_cast<size_t>(neg_n);
-        } else {
-          diff remaining = neg_n - index_in_array_ - 1;
-          diff num_arrays_to_skip = remaining / kArraySize + 1;
-          index_of_array_ -= num_arrays_to_skip;
-          index_in_array_ = kArraySize - 1 - remaining % kArraySize;
-        }
-      }
+      // Unsigned wrap-around handles negative n as long as the result is
+      // a valid position.
+      const size_t kPosition = (index_of_array_ << kArrayShift) +
+                               index_in_array_ + static_cast<size_t>(n);
+      index_of_array_ = kPosition >> kArrayShift;
+      index_in_array_ = kPosition & kArrayMask;
       return *this;
     }
 
@@ -463,9 +517,10 @@ class Deque {
     }
 
     diff operator-(const Iterator<IsConst>& other) const {
-      return static_cast<diff>(index_of_array_) * kArraySize + index_in_array_ -
-             static_cast<diff>(other.index_of_array_) * kArraySize -
-             other.index_in_array_;
+      return static_cast<diff>((index_of_array_ << kArrayShift) +
+                               index_in_array_ -
+                               (other.index_of_array_ << kArrayShift) -
+                               other.index_in_array_);
     }
 
     reference operator*() const {
@@ -479,10 +534,12 @@ class Deque {
     }
 
    private:
-    const std::vector<T*>* body_;
+    const Map* body_;
     size_t index_of_array_;
     size_t index_in_array_;
-    static const size_t kArraySize = 512;
+    static constexpr size_t kArraySize = ArraySize;
+    static constexpr size_t kArrayShift = std::countr_zero(ArraySize);
+    static constexpr size_t kArrayMask = ArraySize - 1;
   };
 
   using iterator = Iterator<false>;
@@ -542,44 +599,293 @@ class Deque {
     return const_reverse_iterator(begin());
   }
 
-  iterator insert(iterator iter, const T& value) {
-    if (iter == begin()) {
-      emplace_front(value);
-      return begin();
+  iterator insert(const_iterator iter, const T& value) {
+    return emplace(iter, value);
+  }
+
+  iterator insert(const_iterator iter, T&& value) {
+    return emplace(iter, std::move(value));
+  }
+
+  iterator insert(const_iterator iter, size_t count, const T& value) {
+    const size_t kIndex = iter - cbegin();
+    T copy(value);
+    insert_from(kIndex, count, [&copy](size_t) -> const T& { return copy; });
+    return begin() + kIndex;
+  }
+
+  template <typename InputIt,
+            typename = std::enable_if_t<!std::is_integral_v<InputIt>>>
+  iterator insert(const_iterator iter, InputIt first, InputIt last) {
+    const size_t kIndex = iter - cbegin();
+    using category = typename std::iterator_traits<InputIt>::iterator_category;
+    if constexpr (std::is_base_of_v<std::random_access_iterator_tag,
+                                    category>) {
+      if (kIndex == size_) {
+        append_range(first, last);
+        return begin() + kIndex;
+      }
+      if (kIndex == 0) {
+        prepend_range(first, last);
+        return begin();
+      }
+      insert_from(kIndex, static_cast<size_t>(std::distance(first, last)),
+                  [&first](size_t index) -> decltype(auto) {
+                    return first[static_cast<std::ptrdiff_t>(index)];
+                  });
+    } else {
+      Deque tmp(alloc_);
+      for (; first != last; ++first) {
+        tmp.emplace_back(*first);
+      }
+      insert_from(kIndex, tmp.size(), [&tmp](size_t index) -> T&& {
+        return std::move(tmp[index]);
+      });
     }
-    if (iter == end()) {
-      emplace_back(value);
-      return end() - 1;
+    return begin() + kIndex;
+  }
+
+  template <typename... Args>
+  iterator emplace(const_iterator iter, Args&&... args) {
+    const size_t kIndex = iter - cbegin();
+    T value(std::forward<Args>(args)...);
+    insert_from(kIndex, 1,
+                [&value](size_t) -> T&& { return std::move(value); });
+    return begin() + kIndex;
+  }
+
+  iterator erase(const_iterator iter) { return erase(iter, iter + 1); }
+
+  iterator erase(const_iterator first, const_iterator last) {
+    const size_t kIndex = first - cbegin();
+    const size_t kCount = last - first;
+    if (kCount == 0) {
+      return begin() + kIndex;
     }
-    emplace_front(value);
-    for (auto cycle_iter = begin(); cycle_iter <= iter; ++cycle_iter) {
-      std::swap(*cycle_iter, *(cycle_iter + 1));
+    if (kIndex < size_ - kIndex - kCount) {
+      std::move_backward(begin(), begin() + kIndex, begin() + kIndex + kCount);
+      for (size_t i = 0; i < kCount; ++i) {
+        pop_front();
+      }
+    } else {
+      std::move(begin() + kIndex + kCount, end(), begin() + kIndex);
+      for (size_t i = 0; i < kCount; ++i) {
+        pop_back();
+      }
     }
-    return iter - 1;
+    return begin() + kIndex;
+  }
+
+  // Calls func(first, last) for every contiguous [first, last) run of
+  // elements, one run per array, from front to back. If func returns bool,
+  // returning false stops the walk.
+  template <typename Func>
+  void for_each_segment(Func func) {
+    for_each_segment_impl<T>(*this, func);
   }
 
+  template <typename Func>
+  void for_each_segment(Func func) const {
+    for_each_segment_impl<const T>(*this, func);
+  }
+
+ private:
+  // Opens a gap of count elements before index by moving whichever side of
+  // the deque is shorter, then fills it with source(0) ... source(count - 1).
+  // Every existing element is moved exactly once.
+  template <typename Source>
+  void insert_from(size_t index, size_t count, Source&& source) {
+    if (count == 0) {
+      return;
+    }
+    const size_t kAfter = size_ - index;
+    if (index < kAfter) {
+      if (count <= index) {
+        for (size_t i = 0; i < count; ++i) {
+          emplace_front(std::move((*this)[count - 1]));
+        }
+        std::move(begin() + 2 * count, begin() + index + count,
+                  begin() + count);
+        for (size_t i = 0; i < count; ++i) {
+          (*this)[index + i] = source(i);
+        }
+      } else {
+        for (size_t i = count - index; i-- > 0;) {
+          emplace_front(source(i));
+        }
+        for (size_t i = 0; i < index; ++i) {
+          emplace_front(std::move((*this)[count - 1]));
+        }
+        for (size_t i = count - index; i < count; ++i) {
+          (*this)[index + i] = source(i);
+        }
+      }
+    } else {
+      if (count <= kAfter) {
+        for (size_t i = 0; i < count; ++i) {
+          emplace_back(std::move((*this)[size_ - count]));
+        }
+        std::move_backward(begin() + index, end() - 2 * count, end() - count);
+        for (size_t i = 0; i < count; ++i) {
+          (*this)[index + i] = source(i);
+        }
+      } else {
+        for (size_t i = kAfter; i < count; ++i) {
+          emplace_back(source(i));
+        }
+        for (size_t i = 0; i < kAfter; ++i) {
+          emplace_back(std::move((*this)[index + i]));
+        }
+        for (size_t i = 0; i < kAfter; ++i) {
+          (*this)[index + i] = source(i);
+        }
+      }
+    }
+  }
+
+  // Builds count elements after the back, array by array: fill(first, n)
+  // has to construct n elements at first or construct none and throw.
+  template <typename Fill>
+  void append_blocks(size_t count, Fill fill) {
+    if (count == 0) {
+      return;
+    }
+    reserve_back(count);
+    const size_t kPosition = last_position() + 1;
+    construct_blocks(kPosition, count, fill);
+    set_last_position(kPosition + count - 1);
+    size_ += count;
+  }
+
+  template <typename Fill>
+  void prepend_blocks(size_t count, Fill fill) {
+    if (count == 0) {
+      return;
+    }
+    reserve_front(count);
+    const size_t kPosition = first_position() - count;
+    construct_blocks(kPosition, count, fill);
+    set_first_position(kPosition);
+    size_ += count;
+  }
+
+  // Constructs the map positions [position, position + count), whose arrays
+  // are already allocated. On exception everything built here is destroyed.
+  template <typename Fill>
+  void construct_blocks(size_t position, size_t count, Fill& fill) {
+    const size_t kFirst = position;
+    try {
+      while (count != 0) {
+        const size_t kInArray = position & kArrayMask;
+        const size_t kChunk = std::min(kArraySize - kInArray, count);
+        fill(body_[position >> kArrayShift] + kInArray, kChunk);
+        position += kChunk;
+        count -= kChunk;
+      }
+    } catch (...) {
+      for (size_t i = kFirst; i != position; ++i) {
+        array_traits::destroy(alloc_, &body_[i >> kArrayShift][i & kArrayMask]);
+      }
+      throw;
+    }
+  }
+
+  // Constructs count elements at destination from args: value-initialized
+  // if args is empty, copies of args otherwise.
   template <typename... Args>
-  iterator emplace(const_iterator c_iterator, Args&&... args) {
-    return insert(c_iterator, std::forward<Args>(args)...);
+  void construct_n(T* destination, size_t count, const Args&... args) {
+    if constexpr (kPlainAllocator && sizeof...(Args) == 0) {
+      std::uninitialized_value_construct_n(destination, count);
+    } else if constexpr (kPlainAllocator) {
+      std::uninitialized_fill_n(destination, count, args...);
+    } else {
+      size_t i = 0;
+      try {
+        for (; i < count; ++i) {
+          array_traits::construct(alloc_, destination + i, args...);
+        }
+      } catch (...) {
+        while (i-- > 0) {
+          array_traits::destroy(alloc_, destination + i);
+        }
+        throw;
+      }
+    }
   }
 
-  iterator erase(iterator iter) {
-    if (iter == begin()) {
-      pop_front();
-      return begin();
+  // Copy-constructs count elements from first at destination and returns
+  // the iterator past the last one read.
+  template <typename It>
+  It copy_n(It first, size_t count, T* destination) {
+    if constexpr (kPlainAllocator && std::is_trivially_copyable_v<T> &&
+                  std::contiguous_iterator<It> &&
+                  std::is_same_v<std::iter_value_t<It>, T>) {
+      std::memcpy(destination, std::to_address(first), count * sizeof(T));
+      return first + static_cast<std::ptrdiff_t>(count);
+    } else if constexpr (kPlainAllocator) {
+      It last = std::next(first, static_cast<std::ptrdiff_t>(count));
+      std::uninitialized_copy(first, last, destination);
+      return last;
+    } else {
+      size_t i = 0;
+      try {
+        for (; i < count; ++i, ++first) {
+          array_traits::construct(alloc_, destination + i, *first);
+        }
+      } catch (...) {
+        while (i-- > 0) {
+          array_traits::destroy(alloc_, destination + i);
+        }
+        throw;
+      }
+      return first;
     }
-    if (iter == end() - 1) {
-      pop_back();
-      return end();
+  }
+
+  size_t first_position() const {
+    return (first_array_index_ << kArrayShift) + first_in_array_index_;
+  }
+
+  size_t last_position() const {
+    return (last_array_index_ << kArrayShift) + last_in_array_index_;
+  }
+
+  void set_first_position(size_t position) {
+    first_array_index_ = position >> kArrayShift;
+    first_in_array_index_ = position & kArrayMask;
+  }
+
+  void set_last_position(size_t position) {
+    last_array_index_ = position >> kArrayShift;
+    last_in_array_index_ = position & kArrayMask;
+  }
+
+  template <typename Value, typename Self, typename Func>
+  static void for_each_segment_impl(Self& self, Func& func) {
+    if (self.size_ == 0) {
+      return;
     }
-    for (auto cycle_iter = iter; cycle_iter > begin(); --cycle_iter) {
-      *(cycle_iter) = *(cycle_iter - 1);
+    for (size_t i = self.first_array_index_; i <= self.last_array_index_;
+         ++i) {
+      Value* first = self.body_[i];
+      Value* last = self.body_[i] + kArraySize;
+      if (i == self.first_array_index_) {
+        first += self.first_in_array_index_;
+      }
+      if (i == self.last_array_index_) {
+        last = self.body_[i] + self.last_in_array_index_ + 1;
+      }
+      if constexpr (std::is_same_v<std::invoke_result_t<Func&, Value*, Value*>,
+                                   bool>) {
+        if (!func(first, last)) {
+          return;
+        }
+      } else {
+        func(first, last);
+      }
     }
-    pop_front();
-    return iter;
   }
 
- private:
   size_t capacity() { return capacity_of_arr_; }
 
   auto last_element() {
@@ -590,24 +896,17 @@ class Deque {
     return &body_[first_array_index_][first_in_array_index_];
   }
 
-  bool back_increase_capacity_condition() {
-    return (capacity_of_arr_ == last_array_index_ + 1 &&
-            kArraySize == last_in_array_index_ + 2);
-  }
-
-  bool front_increase_capacity_condition() {
-    return (first_array_index_ == 0 && first_in_array_index_ == 0);
-  }
-
   void check_index(size_t index) const {
     if (index >= size_) {
       throw std::out_of_range("Index out of range");
     }
   }
 
+  // An empty deque keeps its position in the middle of the current array,
+  // so the next push to either end needs no new array.
   void set_indexes_in_array() {
     first_in_array_index_ = kArraySize / 2;
-    last_in_array_index_ = kArraySize / 2;
+    last_in_array_index_ = kArraySize / 2 - 1;
   }
 
   void set_array_indexes() {
@@ -615,35 +914,145 @@ class Deque {
     last_array_index_ = capacity_of_arr_ / 2;
   }
 
-  void increase_capacity() {
-    const size_t kNextCapacity = capacity_of_arr_ * 3;
-    std::vector<T*> tmp(kNextCapacity);
-    for (size_t i = 0; i < capacity_of_arr_; ++i) {
-      tmp[i] = body_[i];
+  // Gives the map at least front_room free slots before the first array
+  // and back_room after the last one. Only array pointers move: while the
+  // map would stay at most half full the arrays are recentred in place,
+  // otherwise the map grows by GrowthPolicy::kGrowthFactor. New slots stay
+  // null until emplace_back/emplace_front cross into them.
+  void make_room(size_t front_room, size_t back_room) {
+    const size_t kNeeded =
+        last_array_index_ - first_array_index_ + 1 + front_room + back_room;
+    if (kNeeded * 2 <= capacity_of_arr_) {
+      recenter_map(front_room + (capacity_of_arr_ - kNeeded) / 2);
+      return;
+    }
+    const size_t kNewCapacity =
+        std::max(capacity_of_arr_ * GrowthPolicy::kGrowthFactor, kNeeded);
+    reallocate_map(kNewCapacity, front_room + (kNewCapacity - kNeeded) / 2);
+  }
+
+  // Called on pops that leave an array.
+  void decrease_capacity() {
+    const size_t kUsed = last_array_index_ - first_array_index_ + 1;
+    if (capacity_of_arr_ <= kStartCapacityOfArr ||
+        kUsed * GrowthPolicy::kShrinkFactor > capacity_of_arr_) {
+      return;
+    }
+    const size_t kNewCapacity =
+        std::max(kStartCapacityOfArr, kUsed * GrowthPolicy::kGrowthFactor);
+    try {
+      reallocate_map(kNewCapacity, (kNewCapacity - kUsed) / 2);
+    } catch (...) {
+      // Shrinking is an optimization; a pop must not fail because of it.
+    }
+  }
+
+  // Moves the first array to new_first by rotating the map, so spare
+  // arrays pushed off one end come back in at the other.
+  void recenter_map(size_t new_first) {
+    if (new_first > first_array_index_) {
+      std::rotate(body_.begin(), body_.end() - (new_first - first_array_index_),
+                  body_.end());
+    } else {
+      std::rotate(body_.begin(),
+                  body_.begin() + (first_array_index_ - new_first),
+                  body_.end());
     }
-    for (size_t i = capacity_of_arr_; i < kNextCapacity; ++i) {
-      tmp[i] = array_traits::allocate(alloc_, kArraySize);
+    last_array_index_ = last_array_index_ - first_array_index_ + new_first;
+    first_array_index_ = new_first;
+    gather_spare_arrays();
+  }
+
+  // Copies the array pointers into a map of new_capacity slots with the
+  // first array at new_first. Spare arrays are placed as by recenter_map()
+  // and freed only if their slot is taken.
+  void reallocate_map(size_t new_capacity, size_t new_first) {
+    Map new_body(new_capacity, nullptr, body_.get_allocator());
+    for (size_t i = first_array_index_; i <= last_array_index_; ++i) {
+      new_body[i - first_array_index_ + new_first] = body_[i];
+    }
+    for (size_t i = 0; i < body_.size(); ++i) {
+      if (body_[i] == nullptr ||
+          (i >= first_array_index_ && i <= last_array_index_)) {
+        continue;
+      }
+      T*& slot = new_body[(i % new_capacity + new_capacity -
+                           first_array_index_ % new_capacity + new_first) %
+                          new_capacity];
+      if (slot == nullptr) {
+        slot = body_[i];
+      } else {
+        array_traits::deallocate(alloc_, body_[i], kArraySize);
+      }
     }
-    first_array_index_ += capacity_of_arr_;
-    last_array_index_ += capacity_of_arr_;
-    capacity_of_arr_ = kNextCapacity;
+    body_.swap(new_body);
+    capacity_of_arr_ = new_capacity;
+    last_array_index_ = last_array_index_ - first_array_index_ + new_first;
+    first_array_index_ = new_first;
+    gather_spare_arrays();
+  }
 
-    std::swap(tmp, body_);
+  // Moves spare arrays next to the ends of the deque, where the next
+  // pushes will reuse them instead of allocating.
+  void gather_spare_arrays() {
+    auto is_null = [](T* array) { return array == nullptr; };
+    std::partition(body_.begin(), body_.begin() + first_array_index_, is_null);
+    std::partition(body_.begin() + last_array_index_ + 1, body_.end(),
+                   std::not_fn(is_null));
   }
 
   void initial_allocate() {
+    body_.assign(kStartCapacityOfArr, nullptr);
     capacity_of_arr_ = kStartCapacityOfArr;
-    body_.resize(capacity_of_arr_);
-    for (auto& iterator : body_) {
-      iterator = array_traits::allocate(alloc_, kArraySize);
-    }
     set_indexes_in_array();
     set_array_indexes();
+    try {
+      allocate_array(first_array_index_);
+    } catch (...) {
+      dealloc();
+      throw;
+    }
+  }
+
+  void allocate_array(size_t index) {
+    if (body_[index] == nullptr) {
+      body_[index] = array_traits::allocate(alloc_, kArraySize);
+    }
+  }
+
+  // Called when an end of the deque leaves an array: up to
+  // GrowthPolicy::kMaxSpareArrays arrays stay as spares, the next one past
+  // them is moved to a free slot next to the other end, or given back if
+  // that end already caches GrowthPolicy::kMaxCachedArrays arrays. Slots are
+  // searched cyclically, since recenter_map() rotates a slot past one end
+  // of the map back in next to the other.
+  void release_array(size_t index) {
+    if (index >= body_.size() || body_[index] == nullptr) {
+      return;
+    }
+    T* array = std::exchange(body_[index], nullptr);
+    const size_t kCapacity = body_.size();
+    for (size_t i = 1; i <= GrowthPolicy::kMaxCachedArrays; ++i) {
+      const size_t kSlot =
+          index > last_array_index_
+              ? (first_array_index_ + kCapacity - i) % kCapacity
+              : (last_array_index_ + i) % kCapacity;
+      if (kSlot >= first_array_index_ && kSlot <= last_array_index_) {
+        break;
+      }
+      if (body_[kSlot] == nullptr) {
+        body_[kSlot] = array;
+        return;
+      }
+    }
+    array_traits::deallocate(alloc_, array, kArraySize);
   }
 
   void dealloc() {
     for (auto& iterator : body_) {
-      array_traits::deallocate(alloc_, iterator, kArraySize);
+      if (iterator != nullptr) {
+        array_traits::deallocate(alloc_, iterator, kArraySize);
+      }
     }
     reset(capacity_of_arr_);
     reset(size_);
@@ -654,23 +1063,107 @@ class Deque {
     body_.resize(0);
   }
 
+  // Takes over the map and arrays of other, whose allocator must compare
+  // equal to alloc_, and leaves it empty.
+  void take_storage(Deque& other) noexcept {
+    body_ = std::move(other.body_);
+    first_in_array_index_ = other.first_in_array_index_;
+    last_in_array_index_ = other.last_in_array_index_;
+    first_array_index_ = other.first_array_index_;
+    last_array_index_ = other.last_array_index_;
+    size_ = other.size_;
+    capacity_of_arr_ = other.capacity_of_arr_;
+    other.body_.clear();
+    reset(other.first_in_array_index_);
+    reset(other.last_in_array_index_);
+    reset(other.first_array_index_);
+    reset(other.last_array_index_);
+    reset(other.size_);
+    reset(other.capacity_of_arr_);
+  }
+
   template <typename K>
   void reset(K& member) {
     member = 0;
   }
 
-  std::vector<T*> body_;
+  allocator alloc_;
+  Map body_{map_allocator(alloc_)};
   size_t size_ = 0;
   size_t capacity_of_arr_ = 0;
-  const size_t kStartCapacityOfArr = 64;
+  static constexpr size_t kStartCapacityOfArr = 64;
 
-  using allocator_traits = std::allocator_traits<Allocator>;
-  using allocator = typename allocator_traits::template rebind_alloc<T>;
-  using array_traits = std::allocator_traits<allocator>;
-  allocator alloc_;
   size_t first_in_array_index_ = 0;
   size_t last_in_array_index_ = 0;
-  const size_t kArraySize = 512;
+  static constexpr size_t kArraySize = ArraySize;
+  static constexpr size_t kArrayShift = std::countr_zero(ArraySize);
+  static constexpr size_t kArrayMask = ArraySize - 1;
+  static constexpr bool kPlainAllocator =
+      std::is_same_v<allocator, std::allocator<T>>;
   size_t first_array_index_ = 0;
   size_t last_array_index_ = 0;
 };
+
+// Algorithm overloads that run over whole arrays at a time, so the inner
+// loops work on contiguous memory and can be vectorized.
+
+template <typename T, typename Allocator, size_t ArraySize,
+          typename GrowthPolicy, typename OutputIt>
+OutputIt copy(const Deque<T, Allocator, ArraySize, GrowthPolicy>& deque,
+              OutputIt out) {
+  deque.for_each_segment(
+      [&out](const T* first, const T* last) {
+        out = std::copy(first, last, out);
+      });
+  return out;
+}
+
+template <typename T, typename Allocator, size_t ArraySize,
+          typename GrowthPolicy>
+void fill(Deque<T, Allocator, ArraySize, GrowthPolicy>& deque, const T& value) {
+  deque.for_each_segment(
+      [&value](T* first, T* last) { std::fill(first, last, value); });
+}
+
+template <typename T, typename Allocator, size_t ArraySize,
+          typename GrowthPolicy>
+typename Deque<T, Allocator, ArraySize, GrowthPolicy>::iterator find(
+    const Deque<T, Allocator, ArraySize, GrowthPolicy>& deque, const T& value) {
+  size_t index = 0;
+  deque.for_each_segment([&index, &value](const T* first, const T* last) {
+    const T* found = std::find(first, last, value);
+    index += found - first;
+    return found == last;
+  });
+  return deque.begin() + static_cast<std::ptrdiff_t>(index);
+}
+
+template <typename T, typename Allocator, size_t ArraySize,
+          typename GrowthPolicy, typename Init, typename BinaryOp = std::plus<>>
+Init accumulate(const Deque<T, Allocator, ArraySize, GrowthPolicy>& deque,
+                Init init, BinaryOp op = BinaryOp()) {
+  deque.for_each_segment([&init, &op](const T* first, const T* last) {
+    init = std::accumulate(first, last, std::move(init), op);
+  });
+  return init;
+}
+
+template <typename T, typename Allocator, size_t ArraySize,
+          typename GrowthPolicy, typename OutputIt, typename UnaryOp>
+OutputIt transform(const Deque<T, Allocator, ArraySize, GrowthPolicy>& deque,
+                   OutputIt out, UnaryOp op) {
+  deque.for_each_segment([&out, &op](const T* first, const T* last) {
+    out = std::transform(first, last, out, op);
+  });
+  return out;
+}
+
+namespace pmr {
+
+// Deque whose map and arrays are all allocated from a memory_resource.
+template <typename T, size_t ArraySize = kDequeArraySize<T>,
+          typename GrowthPolicy = DequeGrowthPolicy>
+using Deque =
+    ::Deque<T, std::pmr::polymorphic_allocator<T>, ArraySize, GrowthPolicy>;
+
+}  // namespace pmr
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Epoch-based memory reclamation for lock-free containers. Threads read
+// shared nodes only inside a Guard, which pins the global epoch the thread
+// saw on entry. A node unlinked and then retired in epoch e can only still
+// be reached by threads that entered at e or earlier. The epoch moves on
+// only once every thread inside a guard has seen the current one, so by
+// epoch e + 2 those readers are gone and the node is freed.
+//
+// Each thread owns a record holding its pinned epoch and three limbo lists,
+// one per epoch modulo 3. Records are never freed; a thread that exits
+// leaves its record for the next new thread to take over.
+class EpochReclaimer {
+ public:
+  class Guard {
+   public:
+    Guard() { enter(); }
+    ~Guard() { leave(); }
+    Guard(const Guard&) = delete;
+    Guard& operator=(const Guard&) = delete;
+  };
+
+  // Frees pointer with deleter once no guard that may have seen it is
+  // still open. pointer must already be unreachable for new readers.
+  static void retire(void* pointer, void (*deleter)(void*)) {
+    Record* record = local_record();
+    const uint64_t kEpoch = epoch_.load(std::memory_order_seq_cst);
+    Limbo& limbo = record->limbo[kEpoch % kLimboCount];
+    if (limbo.epoch != kEpoch) {
+      // The list last held epoch kEpoch - 3 or older: safe to free.
+      free_all(limbo);
+      limbo.epoch = kEpoch;
+    }
+    limbo.items.push_back({pointer, deleter});
+    if (++record->retired_since_advance >= kAdvanceInterval) {
+      record->retired_since_advance = 0;
+      try_advance();
+      collect(record, epoch_.load(std::memory_order_seq_cst));
+    }
+  }
+
+ private:
+  struct Retired {
+    void* pointer;
+    void (*deleter)(void*);
+  };
+
+  struct Limbo {
+    uint64_t epoch = 0;
+    std::vector<Retired> items;
+  };
+
+  static constexpr size_t kLimboCount = 3;
+  // Retires between attempts to advance the epoch.
+  static constexpr size_t kAdvanceInterval = 64;
+  static constexpr uint64_t kActive = 1;
+  static constexpr size_t kCacheLineSize = 64;
+
+  struct alignas(kCacheLineSize) Record {
+    // The pinned epoch shifted left by one, or'ed with kActive while the
+    // thread is inside a guard.
+    std::atomic<uint64_t> state{0};
+    std::atomic<bool> in_use{true};
+    Record* next = nullptr;
+    size_t depth = 0;
+    size_t retired_since_advance = 0;
+    std::array<Limbo, kLimboCount> limbo;
+  };
+
+  // Gives the record back when its thread exits.
+  struct LocalRecord {
+    Record* record;
+
+    constexpr LocalRecord() : record(nullptr) {}
+    ~LocalRecord() {
+      if (record != nullptr) {
+        record->in_use.store(false, std::memory_order_release);
+      }
+    }
+  };
+
+  static void enter() {
+    Record* record = local_record();
+    if (record->depth++ != 0) {
+      return;
+    }
+    const uint64_t kEpoch = epoch_.load(std::memory_order_seq_cst);
+    record->state.store(kEpoch << 1 | kActive, std::memory_order_seq_cst);
+    collect(record, kEpoch);
+  }
+
+  static void leave() {
+    Record* record = local_record();
+    if (--record->depth == 0) {
+      record->state.store(0, std::memory_order_release);
+    }
+  }
+
+  // Advances the epoch if every thread inside a guard has seen it.
+  static void try_advance() {
+    uint64_t epoch = epoch_.load(std::memory_order_seq_cst);
+    for (Record* record = records_.load(std::memory_order_acquire);
+         record != nullptr; record = record->next) {
+      const uint64_t kState = record->state.load(std::memory_order_seq_cst);
+      if ((kState & kActive) != 0 && kState >> 1 != epoch) {
+        return;
+      }
+    }
+    epoch_.compare_exchange_strong(epoch, epoch + 1,
+                                   std::memory_order_seq_cst);
+  }
+
+  // Frees the limbo lists of this thread that are two epochs old.
+  static void collect(Record* record, uint64_t epoch) {
+    for (Limbo& limbo : record->limbo) {
+      if (limbo.epoch + 2 <= epoch) {
+        free_all(limbo);
+      }
+    }
+  }
+
+  static void free_all(Limbo& limbo) {
+    for (const Retired& retired : limbo.items) {
+      retired.deleter(retired.pointer);
+    }
+    limbo.items.clear();
+  }
+
+  // Reuses the record of an exited thread or registers a new one.
+  static Record* local_record() {
+    LocalRecord& local = local_;
+    if (local.record != nullptr) {
+      return local.record;
+    }
+    for (Record* record = records_.load(std::memory_order_acquire);
+         record != nullptr; record = record->next) {
+      bool in_use = false;
+      if (!record->in_use.load(std::memory_order_relaxed) &&
+          record->in_use.compare_exchange_strong(in_use, true,
+                                                 std::memory_order_acquire)) {
+        return local.record = record;
+      }
+    }
+    auto* record = new Record;
+    record->next = records_.load(std::memory_order_relaxed);
+    while (!records_.compare_exchange_weak(record->next, record,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+    }
+    return local.record = record;
+  }
+
+  static inline std::atomic<uint64_t> epoch_{0};
+  static inline std::atomic<Record*> records_{nullptr};
+  static inline thread_local LocalRecord local_;
+};
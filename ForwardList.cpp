@@ -0,0 +1,571 @@
+#pragma once
+
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <type_traits>
+#include <utility>
+
+// Singly linked list with one link per node. fake_ sits before the first
+// node, so every insertion and removal is an *_after operation on some
+// node, and tail_ points at the last node (or at fake_ when the list is
+// empty) to make push_back O(1).
+template <typename T, typename Allocator = std::allocator<T>>
+class ForwardList {
+ private:
+  struct BaseNode {
+    BaseNode* next = nullptr;
+  };
+
+  struct Node : BaseNode {
+    T value;
+    template <typename... Args>
+    explicit Node(Args&&... args) : value(std::forward<Args>(args)...) {}
+  };
+  BaseNode fake_;
+  BaseNode* tail_ = &fake_;
+  size_t size_ = 0;
+  using node_alloc =
+      typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+  using node_traits = typename std::allocator_traits<node_alloc>;
+  node_alloc alloc_;
+
+  static constexpr bool kPropagateOnCopy =
+      node_traits::propagate_on_container_copy_assignment::value;
+  static constexpr bool kPropagateOnMove =
+      node_traits::propagate_on_container_move_assignment::value;
+
+  template <typename... Args>
+  Node* create_node(Args&&... args) {
+    Node* new_node = node_traits::allocate(alloc_, 1);
+    try {
+      node_traits::construct(alloc_, new_node, std::forward<Args>(args)...);
+    } catch (...) {
+      node_traits::deallocate(alloc_, new_node, 1);
+      throw;
+    }
+    return new_node;
+  }
+  void destroy_node(BaseNode* node) {
+    Node* value_node = static_cast<Node*>(node);
+    node_traits::destroy(alloc_, value_node);
+    node_traits::deallocate(alloc_, value_node, 1);
+  }
+  void link_after(BaseNode* pos, BaseNode* new_node) {
+    new_node->next = pos->next;
+    pos->next = new_node;
+    if (tail_ == pos) {
+      tail_ = new_node;
+    }
+  }
+  void swap_nodes(ForwardList& other) noexcept {
+    std::swap(fake_.next, other.fake_.next);
+    std::swap(tail_, other.tail_);
+    std::swap(size_, other.size_);
+    if (tail_ == &other.fake_) {
+      tail_ = &fake_;
+    }
+    if (other.tail_ == &fake_) {
+      other.tail_ = &other.fake_;
+    }
+  }
+
+ public:
+  using value_type = T;
+  using allocator_type = Allocator;
+  template <bool IsConst>
+  class MyIterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = std::conditional_t<IsConst, const T, T>;
+    using pointer = std::conditional_t<IsConst, const T*, T*>;
+    using reference = std::conditional_t<IsConst, const T&, T&>;
+    MyIterator() : head_(nullptr) {}
+    MyIterator(BaseNode* node) : head_(node) {}
+    operator MyIterator<true>() const
+      requires(!IsConst)
+    {
+      return MyIterator<true>(head_);
+    }
+    reference operator*() const { return static_cast<Node*>(head_)->value; }
+    pointer operator->() const { return &static_cast<Node*>(head_)->value; }
+    MyIterator& operator++() {
+      head_ = head_->next;
+      return *this;
+    }
+    MyIterator operator++(int) {
+      MyIterator old = *this;
+      ++(*this);
+      return old;
+    }
+    bool operator==(const MyIterator& other) const {
+      return head_ == other.head_;
+    }
+
+    bool operator!=(const MyIterator& other) const {
+      return head_ != other.head_;
+    }
+
+   private:
+    friend class ForwardList;
+    BaseNode* head_;
+  };
+  using iterator = MyIterator<false>;
+  using const_iterator = MyIterator<true>;
+
+  iterator before_begin() const {
+    return iterator(const_cast<BaseNode*>(&fake_));
+  }
+  iterator begin() const { return iterator(fake_.next); }
+  iterator end() const { return iterator(nullptr); }
+  const_iterator cbefore_begin() const { return before_begin(); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+
+  ForwardList() = default;
+  explicit ForwardList(const Allocator& alloc) : alloc_(alloc) {}
+  ForwardList(std::initializer_list<T> init,
+              const Allocator& alloc = Allocator())
+      : alloc_(alloc) {
+    try {
+      for (const auto& value : init) {
+        push_back(value);
+      }
+    } catch (...) {
+      clear();
+      throw;
+    }
+  }
+  ForwardList(const ForwardList& other)
+      : ForwardList(other, node_traits::select_on_container_copy_construction(
+                               other.alloc_)) {}
+  ForwardList(const ForwardList& other, const Allocator& alloc)
+      : alloc_(alloc) {
+    try {
+      for (const auto& value : other) {
+        push_back(value);
+      }
+    } catch (...) {
+      clear();
+      throw;
+    }
+  }
+  ForwardList(ForwardList&& other) noexcept : alloc_(std::move(other.alloc_)) {
+    swap_nodes(other);
+  }
+  ForwardList& operator=(const ForwardList& other) {
+    if (this != &other) {
+      ForwardList temp(other, kPropagateOnCopy ? other.alloc_ : alloc_);
+      swap_nodes(temp);
+      if constexpr (kPropagateOnCopy) {
+        std::swap(alloc_, temp.alloc_);
+      }
+    }
+    return *this;
+  }
+  ForwardList& operator=(ForwardList&& other) noexcept(
+      kPropagateOnMove || node_traits::is_always_equal::value) {
+    if (this == &other) {
+      return *this;
+    }
+    clear();
+    if constexpr (kPropagateOnMove) {
+      alloc_ = std::move(other.alloc_);
+    } else if (alloc_ != other.alloc_) {
+      for (auto& value : other) {
+        push_back(std::move(value));
+      }
+      other.clear();
+      return *this;
+    }
+    swap_nodes(other);
+    return *this;
+  }
+  ~ForwardList() { clear(); }
+
+  T& front() const { return static_cast<Node*>(fake_.next)->value; }
+  T& back() const { return static_cast<Node*>(tail_)->value; }
+
+  void push_front(const T& value) { emplace_front(value); }
+  void push_front(T&& value) { emplace_front(std::move(value)); }
+  void push_back(const T& value) { emplace_back(value); }
+  void push_back(T&& value) { emplace_back(std::move(value)); }
+  template <typename... Args>
+  T& emplace_front(Args&&... args) {
+    return *emplace_after(cbefore_begin(), std::forward<Args>(args)...);
+  }
+  template <typename... Args>
+  T& emplace_back(Args&&... args) {
+    return *emplace_after(const_iterator(tail_), std::forward<Args>(args)...);
+  }
+  template <typename... Args>
+  iterator emplace_after(const_iterator pos, Args&&... args) {
+    Node* new_node = create_node(std::forward<Args>(args)...);
+    link_after(pos.head_, new_node);
+    ++size_;
+    return iterator(new_node);
+  }
+  iterator insert_after(const_iterator pos, const T& value) {
+    return emplace_after(pos, value);
+  }
+  iterator insert_after(const_iterator pos, T&& value) {
+    return emplace_after(pos, std::move(value));
+  }
+  void pop_front() { erase_after(cbefore_begin()); }
+  // Removes the node after pos and returns the one after it.
+  iterator erase_after(const_iterator pos) {
+    BaseNode* node = pos.head_->next;
+    pos.head_->next = node->next;
+    if (tail_ == node) {
+      tail_ = pos.head_;
+    }
+    destroy_node(node);
+    --size_;
+    return iterator(pos.head_->next);
+  }
+  // Removes the nodes strictly between first and last.
+  iterator erase_after(const_iterator first, const_iterator last) {
+    while (first.head_->next != last.head_) {
+      erase_after(first);
+    }
+    return iterator(last.head_);
+  }
+  void clear() {
+    while (!empty()) {
+      pop_front();
+    }
+  }
+  // Moves all nodes of other after pos. Walking other to count it is not
+  // needed: other keeps its size_ and tail_.
+  void splice_after(const_iterator pos, ForwardList& other) {
+    if (this == &other || other.empty()) {
+      return;
+    }
+    BaseNode* last = other.tail_;
+    last->next = pos.head_->next;
+    pos.head_->next = other.fake_.next;
+    if (tail_ == pos.head_) {
+      tail_ = last;
+    }
+    size_ += other.size_;
+    other.fake_.next = nullptr;
+    other.tail_ = &other.fake_;
+    other.size_ = 0;
+  }
+  void splice_after(const_iterator pos, ForwardList&& other) {
+    splice_after(pos, other);
+  }
+  // Moves the node after it, from other or from this list, after pos.
+  void splice_after(const_iterator pos, ForwardList& other,
+                    const_iterator it) {
+    BaseNode* node = it.head_->next;
+    if (pos.head_ == it.head_ || pos.head_ == node) {
+      return;
+    }
+    it.head_->next = node->next;
+    if (other.tail_ == node) {
+      other.tail_ = it.head_;
+    }
+    link_after(pos.head_, node);
+    if (this != &other) {
+      ++size_;
+      --other.size_;
+    }
+  }
+  void splice_after(const_iterator pos, ForwardList&& other,
+                    const_iterator it) {
+    splice_after(pos, other, it);
+  }
+  void swap(ForwardList& other) noexcept {
+    swap_nodes(other);
+    if constexpr (node_traits::propagate_on_container_swap::value) {
+      std::swap(alloc_, other.alloc_);
+    }
+  }
+  size_t size() const { return size_; }
+  bool empty() const { return size() == 0; }
+  Allocator get_allocator() const { return Allocator(alloc_); }
+};
+
+template <typename T, typename Allocator>
+void swap(ForwardList<T, Allocator>& lhs,
+          ForwardList<T, Allocator>& rhs) noexcept {
+  lhs.swap(rhs);
+}
+
+// Bidirectional list that stores one link word per node: prev ^ next. An
+// iterator carries the node it came from, so it can recover the other
+// neighbour in either direction. The ends are null links, with head_ and
+// tail_ pointing at the first and last nodes; reverse() only swaps them.
+//
+// Insertion before an iterator and erasure at one change the links of
+// the neighbours, so they invalidate iterators to those neighbours.
+template <typename T, typename Allocator = std::allocator<T>>
+class XorList {
+ private:
+  struct Node {
+    uintptr_t link = 0;
+    T value;
+    template <typename... Args>
+    explicit Node(Args&&... args) : value(std::forward<Args>(args)...) {}
+  };
+  static Node* other_side(const Node* node, const Node* from) {
+    return reinterpret_cast<Node*>(node->link ^
+                                   reinterpret_cast<uintptr_t>(from));
+  }
+  static void replace_neighbour(Node* node, Node* from, Node* to) {
+    if (node != nullptr) {
+      node->link ^= reinterpret_cast<uintptr_t>(from) ^
+                    reinterpret_cast<uintptr_t>(to);
+    }
+  }
+
+  Node* head_ = nullptr;
+  Node* tail_ = nullptr;
+  size_t size_ = 0;
+  using node_alloc =
+      typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+  using node_traits = typename std::allocator_traits<node_alloc>;
+  node_alloc alloc_;
+
+  static constexpr bool kPropagateOnCopy =
+      node_traits::propagate_on_container_copy_assignment::value;
+  static constexpr bool kPropagateOnMove =
+      node_traits::propagate_on_container_move_assignment::value;
+
+  template <typename... Args>
+  Node* create_node(Args&&... args) {
+    Node* new_node = node_traits::allocate(alloc_, 1);
+    try {
+      node_traits::construct(alloc_, new_node, std::forward<Args>(args)...);
+    } catch (...) {
+      node_traits::deallocate(alloc_, new_node, 1);
+      throw;
+    }
+    return new_node;
+  }
+  void swap_nodes(XorList& other) noexcept {
+    std::swap(head_, other.head_);
+    std::swap(tail_, other.tail_);
+    std::swap(size_, other.size_);
+  }
+
+ public:
+  using value_type = T;
+  using allocator_type = Allocator;
+  template <bool IsConst>
+  class MyIterator {
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = std::conditional_t<IsConst, const T, T>;
+    using pointer = std::conditional_t<IsConst, const T*, T*>;
+    using reference = std::conditional_t<IsConst, const T&, T&>;
+    MyIterator() : prev_(nullptr), head_(nullptr) {}
+    MyIterator(Node* prev, Node* node) : prev_(prev), head_(node) {}
+    operator MyIterator<true>() const
+      requires(!IsConst)
+    {
+      return MyIterator<true>(prev_, head_);
+    }
+    reference operator*() const { return head_->value; }
+    pointer operator->() const { return &head_->value; }
+    MyIterator& operator++() {
+      Node* next = other_side(head_, prev_);
+      prev_ = head_;
+      head_ = next;
+      return *this;
+    }
+    MyIterator operator++(int) {
+      MyIterator old = *this;
+      ++(*this);
+      return old;
+    }
+    MyIterator& operator--() {
+      Node* prev = other_side(prev_, head_);
+      head_ = prev_;
+      prev_ = prev;
+      return *this;
+    }
+    MyIterator operator--(int) {
+      MyIterator old = *this;
+      --(*this);
+      return old;
+    }
+    bool operator==(const MyIterator& other) const {
+      return head_ == other.head_ && prev_ == other.prev_;
+    }
+
+    bool operator!=(const MyIterator& other) const {
+      return !(*this == other);
+    }
+
+   private:
+    friend class XorList;
+    Node* prev_;
+    Node* head_;
+  };
+  using iterator = MyIterator<false>;
+  using const_iterator = MyIterator<true>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  iterator begin() const { return iterator(nullptr, head_); }
+  iterator end() const { return iterator(tail_, nullptr); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+  reverse_iterator rbegin() const { return reverse_iterator(end()); }
+  reverse_iterator rend() const { return reverse_iterator(begin()); }
+
+  XorList() = default;
+  explicit XorList(const Allocator& alloc) : alloc_(alloc) {}
+  XorList(std::initializer_list<T> init, const Allocator& alloc = Allocator())
+      : alloc_(alloc) {
+    try {
+      for (const auto& value : init) {
+        push_back(value);
+      }
+    } catch (...) {
+      clear();
+      throw;
+    }
+  }
+  XorList(const XorList& other)
+      : XorList(other, node_traits::select_on_container_copy_construction(
+                           other.alloc_)) {}
+  XorList(const XorList& other, const Allocator& alloc) : alloc_(alloc) {
+    try {
+      for (const auto& value : other) {
+        push_back(value);
+      }
+    } catch (...) {
+      clear();
+      throw;
+    }
+  }
+  XorList(XorList&& other) noexcept : alloc_(std::move(other.alloc_)) {
+    swap_nodes(other);
+  }
+  XorList& operator=(const XorList& other) {
+    if (this != &other) {
+      XorList temp(other, kPropagateOnCopy ? other.alloc_ : alloc_);
+      swap_nodes(temp);
+      if constexpr (kPropagateOnCopy) {
+        std::swap(alloc_, temp.alloc_);
+      }
+    }
+    return *this;
+  }
+  XorList& operator=(XorList&& other) noexcept(
+      kPropagateOnMove || node_traits::is_always_equal::value) {
+    if (this == &other) {
+      return *this;
+    }
+    clear();
+    if constexpr (kPropagateOnMove) {
+      alloc_ = std::move(other.alloc_);
+    } else if (alloc_ != other.alloc_) {
+      for (auto& value : other) {
+        push_back(std::move(value));
+      }
+      other.clear();
+      return *this;
+    }
+    swap_nodes(other);
+    return *this;
+  }
+  ~XorList() { clear(); }
+
+  T& front() const { return head_->value; }
+  T& back() const { return tail_->value; }
+
+  void push_back(const T& value) { emplace(cend(), value); }
+  void push_back(T&& value) { emplace(cend(), std::move(value)); }
+  void push_front(const T& value) { emplace(cbegin(), value); }
+  void push_front(T&& value) { emplace(cbegin(), std::move(value)); }
+  template <typename... Args>
+  T& emplace_back(Args&&... args) {
+    return *emplace(cend(), std::forward<Args>(args)...);
+  }
+  template <typename... Args>
+  T& emplace_front(Args&&... args) {
+    return *emplace(cbegin(), std::forward<Args>(args)...);
+  }
+  // Links the new node between pos.prev_ and pos.head_.
+  template <typename... Args>
+  iterator emplace(const_iterator pos, Args&&... args) {
+    Node* new_node = create_node(std::forward<Args>(args)...);
+    Node* prev = pos.prev_;
+    Node* next = pos.head_;
+    new_node->link =
+        reinterpret_cast<uintptr_t>(prev) ^ reinterpret_cast<uintptr_t>(next);
+    replace_neighbour(prev, next, new_node);
+    replace_neighbour(next, prev, new_node);
+    if (prev == nullptr) {
+      head_ = new_node;
+    }
+    if (next == nullptr) {
+      tail_ = new_node;
+    }
+    ++size_;
+    return iterator(prev, new_node);
+  }
+  iterator insert(const_iterator pos, const T& value) {
+    return emplace(pos, value);
+  }
+  iterator insert(const_iterator pos, T&& value) {
+    return emplace(pos, std::move(value));
+  }
+  iterator erase(const_iterator pos) {
+    Node* prev = pos.prev_;
+    Node* node = pos.head_;
+    Node* next = other_side(node, prev);
+    replace_neighbour(prev, node, next);
+    replace_neighbour(next, node, prev);
+    if (prev == nullptr) {
+      head_ = next;
+    }
+    if (next == nullptr) {
+      tail_ = prev;
+    }
+    node_traits::destroy(alloc_, node);
+    node_traits::deallocate(alloc_, node, 1);
+    --size_;
+    return iterator(prev, next);
+  }
+  void pop_back() { erase(--cend()); }
+  void pop_front() { erase(cbegin()); }
+  void clear() {
+    while (!empty()) {
+      pop_front();
+    }
+  }
+  // The links are symmetric, so reversing only exchanges the ends.
+  void reverse() noexcept { std::swap(head_, tail_); }
+  void swap(XorList& other) noexcept {
+    swap_nodes(other);
+    if constexpr (node_traits::propagate_on_container_swap::value) {
+      std::swap(alloc_, other.alloc_);
+    }
+  }
+  size_t size() const { return size_; }
+  bool empty() const { return size() == 0; }
+  Allocator get_allocator() const { return Allocator(alloc_); }
+};
+
+template <typename T, typename Allocator>
+void swap(XorList<T, Allocator>& lhs, XorList<T, Allocator>& rhs) noexcept {
+  lhs.swap(rhs);
+}
+
+namespace pmr {
+
+template <typename T>
+using ForwardList = ::ForwardList<T, std::pmr::polymorphic_allocator<T>>;
+
+template <typename T>
+using XorList = ::XorList<T, std::pmr::polymorphic_allocator<T>>;
+
+}  // namespace pmr
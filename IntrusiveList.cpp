@@ -0,0 +1,266 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+// The prev/next pair shared by the hooks and the list sentinel.
+struct IntrusiveListNode {
+  IntrusiveListNode* prev = nullptr;
+  IntrusiveListNode* next = nullptr;
+};
+
+enum class HookMode {
+  // Links are left dangling after an unlink; nothing is checked.
+  kNormal,
+  // Unlinked hooks are nulled, linking a linked hook and destroying a
+  // linked object trip an assert.
+  kSafe,
+  // As kSafe, but a linked object unlinks itself when destroyed.
+  kAutoUnlink,
+};
+
+// Base class that makes an object linkable into an IntrusiveList. Tag
+// tells apart several hooks of one object, so that it can be in several
+// lists at once:
+//
+//   struct Task : IntrusiveListHook<struct ReadyTag>,
+//                 IntrusiveListHook<struct TimerTag> {};
+//   IntrusiveList<Task, IntrusiveListHook<ReadyTag>> ready;
+//
+// Copying an object does not copy its links.
+template <typename Tag = void, HookMode Mode = HookMode::kNormal>
+class IntrusiveListHook : private IntrusiveListNode {
+ public:
+  static constexpr HookMode kMode = Mode;
+
+  IntrusiveListHook() = default;
+  IntrusiveListHook(const IntrusiveListHook&) noexcept {}
+  IntrusiveListHook& operator=(const IntrusiveListHook&) noexcept {
+    return *this;
+  }
+
+  ~IntrusiveListHook() {
+    if constexpr (Mode == HookMode::kAutoUnlink) {
+      unlink();
+    } else if constexpr (Mode == HookMode::kSafe) {
+      assert(!is_linked() && "destroying an object that is still linked");
+    }
+  }
+
+  bool is_linked() const
+    requires(Mode != HookMode::kNormal)
+  {
+    return next != nullptr;
+  }
+
+  // Removes the object from whatever list holds it in O(1). In the checked
+  // modes an unlinked hook is left alone.
+  void unlink() noexcept {
+    if constexpr (Mode != HookMode::kNormal) {
+      if (!is_linked()) {
+        return;
+      }
+    }
+    prev->next = next;
+    next->prev = prev;
+    if constexpr (Mode != HookMode::kNormal) {
+      prev = next = nullptr;
+    }
+  }
+
+ private:
+  template <typename T, typename Hook>
+  friend class IntrusiveList;
+};
+
+// Doubly linked list of objects that derive from Hook, built on the same
+// sentinel design as List: fake_ closes the ring, so linking never
+// branches. The list neither allocates nor copies; it only links objects
+// owned elsewhere, which must outlive their membership.
+//
+// Since an object can unlink itself without the list knowing, the list
+// keeps no element count and size() walks the ring.
+template <typename T, typename Hook = IntrusiveListHook<>>
+class IntrusiveList {
+  static_assert(std::is_base_of_v<Hook, T>,
+                "IntrusiveList elements must derive from their hook");
+
+ private:
+  using BaseNode = IntrusiveListNode;
+
+  static constexpr bool kChecked = Hook::kMode != HookMode::kNormal;
+
+  static BaseNode* node_of(T& value) {
+    return static_cast<BaseNode*>(static_cast<Hook*>(&value));
+  }
+  static T& value_of(BaseNode* node) {
+    return static_cast<T&>(static_cast<Hook&>(*node));
+  }
+
+  static void link_before(BaseNode* pos, BaseNode* node) {
+    if constexpr (kChecked) {
+      assert(node->next == nullptr && "linking an object that is linked");
+    }
+    node->prev = pos->prev;
+    node->next = pos;
+    pos->prev->next = node;
+    pos->prev = node;
+  }
+  static void unlink(BaseNode* node) {
+    static_cast<Hook*>(node)->unlink();
+  }
+
+  void relink_fake(bool is_empty) {
+    if (is_empty) {
+      fake_.prev = fake_.next = &fake_;
+    } else {
+      fake_.next->prev = &fake_;
+      fake_.prev->next = &fake_;
+    }
+  }
+
+  BaseNode fake_{&fake_, &fake_};
+
+ public:
+  using value_type = T;
+  template <bool IsConst>
+  class MyIterator {
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = std::conditional_t<IsConst, const T, T>;
+    using pointer = std::conditional_t<IsConst, const T*, T*>;
+    using reference = std::conditional_t<IsConst, const T&, T&>;
+    MyIterator(BaseNode* node) : head_(node) {}
+    operator MyIterator<true>() const
+      requires(!IsConst)
+    {
+      return MyIterator<true>(head_);
+    }
+    reference operator*() const { return value_of(head_); }
+    pointer operator->() const { return &value_of(head_); }
+    MyIterator& operator++() {
+      head_ = head_->next;
+      return *this;
+    }
+    MyIterator operator++(int) {
+      MyIterator old = *this;
+      ++(*this);
+      return old;
+    }
+    MyIterator& operator--() {
+      head_ = head_->prev;
+      return *this;
+    }
+    MyIterator operator--(int) {
+      MyIterator old = *this;
+      --(*this);
+      return old;
+    }
+    bool operator==(const MyIterator& other) const {
+      return head_ == other.head_;
+    }
+
+    bool operator!=(const MyIterator& other) const {
+      return head_ != other.head_;
+    }
+
+   private:
+    friend class IntrusiveList;
+    BaseNode* head_;
+  };
+  using iterator = MyIterator<false>;
+  using const_iterator = MyIterator<true>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  iterator begin() const { return iterator(fake_.next); }
+  iterator end() const { return iterator(const_cast<BaseNode*>(&fake_)); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+  reverse_iterator rbegin() const { return reverse_iterator(end()); }
+  reverse_iterator rend() const { return reverse_iterator(begin()); }
+
+  IntrusiveList() = default;
+  IntrusiveList(const IntrusiveList&) = delete;
+  IntrusiveList& operator=(const IntrusiveList&) = delete;
+  // Moving relinks the sentinel; the objects stay where they are.
+  IntrusiveList(IntrusiveList&& other) noexcept { swap(other); }
+  IntrusiveList& operator=(IntrusiveList&& other) noexcept {
+    if (this != &other) {
+      clear();
+      swap(other);
+    }
+    return *this;
+  }
+  ~IntrusiveList() { clear(); }
+
+  // Returns an iterator to an object known to be in this list.
+  static iterator iterator_to(T& value) { return iterator(node_of(value)); }
+
+  T& front() const { return value_of(fake_.next); }
+  T& back() const { return value_of(fake_.prev); }
+
+  void push_back(T& value) { link_before(&fake_, node_of(value)); }
+  void push_front(T& value) { link_before(fake_.next, node_of(value)); }
+  void pop_back() { unlink(fake_.prev); }
+  void pop_front() { unlink(fake_.next); }
+  iterator insert(const_iterator pos, T& value) {
+    link_before(pos.head_, node_of(value));
+    return iterator(node_of(value));
+  }
+  // Unlinks the object at pos; it is not destroyed.
+  iterator erase(const_iterator pos) {
+    BaseNode* next = pos.head_->next;
+    unlink(pos.head_);
+    return iterator(next);
+  }
+  // Unlinks every object. Only the checked modes need to visit them, to
+  // reset their hooks.
+  void clear() {
+    if constexpr (kChecked) {
+      while (!empty()) {
+        pop_front();
+      }
+    } else {
+      fake_.prev = fake_.next = &fake_;
+    }
+  }
+  void splice(const_iterator pos, IntrusiveList& other) {
+    if (this == &other || other.empty()) {
+      return;
+    }
+    BaseNode* first = other.fake_.next;
+    BaseNode* last = other.fake_.prev;
+    other.fake_.prev = other.fake_.next = &other.fake_;
+    first->prev = pos.head_->prev;
+    last->next = pos.head_;
+    pos.head_->prev->next = first;
+    pos.head_->prev = last;
+  }
+  void swap(IntrusiveList& other) noexcept {
+    const bool kWasEmpty = empty();
+    const bool kOtherWasEmpty = other.empty();
+    std::swap(fake_, other.fake_);
+    relink_fake(kOtherWasEmpty);
+    other.relink_fake(kWasEmpty);
+  }
+
+  bool empty() const { return fake_.next == &fake_; }
+  size_t size() const {
+    size_t count = 0;
+    for (const BaseNode* node = fake_.next; node != &fake_;
+         node = node->next) {
+      ++count;
+    }
+    return count;
+  }
+};
+
+template <typename T, typename Hook>
+void swap(IntrusiveList<T, Hook>& lhs, IntrusiveList<T, Hook>& rhs) noexcept {
+  lhs.swap(rhs);
+}
@@ -1,9 +1,16 @@
+#pragma once
+
 #include <algorithm>
+#include <functional>
 #include <iostream>
 #include <iterator>
 #include <memory>
+#include <memory_resource>
 #include <string>
 #include <type_traits>
+#include <utility>
+
+#include "Prefetch.cpp"
 
 template <typename T, typename Allocator = std::allocator<T>>
 class List {
@@ -15,12 +22,11 @@ class List {
 
   struct Node : BaseNode {
     T value;
-    Node(){};
-    Node(const T& val) : value(val) {}
+    template <typename... Args>
+    explicit Node(Args&&... args) : value(std::forward<Args>(args)...) {}
   };
   BaseNode fake_;
   size_t size_ = 0;
-  using alloc = std::allocator<T>;
   using node_alloc =
       typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
   using node_traits = typename std::allocator_traits<node_alloc>;
@@ -45,23 +51,105 @@ class List {
     node->next->prev = &fake_;
     fake_.next = node->next;
   }
-  void push_back_from_default_value() {
+  void link_before(BaseNode* pos, BaseNode* new_node) {
+    new_node->prev = pos->prev;
+    new_node->next = pos;
+    pos->prev->next = new_node;
+    pos->prev = new_node;
+  }
+  template <typename... Args>
+  Node* create_node(Args&&... args) {
     Node* new_node = node_traits::allocate(alloc_, 1);
     try {
-      node_traits::construct(alloc_, new_node);
+      node_traits::construct(alloc_, new_node, std::forward<Args>(args)...);
     } catch (...) {
       node_traits::deallocate(alloc_, new_node, 1);
       throw;
     }
-    push_back_balance(new_node);
-    ++size_;
+    return new_node;
   }
-  void swap(List& other) noexcept {
-    while (size_ != 0) {
-      pop_back();
+  void destroy_node(BaseNode* node) {
+    Node* value_node = static_cast<Node*>(node);
+    node_traits::destroy(alloc_, value_node);
+    node_traits::deallocate(alloc_, value_node, 1);
+  }
+  static T& value_of(BaseNode* node) { return static_cast<Node*>(node)->value; }
+  // Moves the nodes [first, last) in front of pos. They may come from
+  // another list; the caller fixes the sizes.
+  static void transfer(BaseNode* pos, BaseNode* first, BaseNode* last) {
+    if (first == last || pos == first || pos == last) {
+      return;
+    }
+    BaseNode* tail = last->prev;
+    first->prev->next = last;
+    last->prev = first->prev;
+    first->prev = pos->prev;
+    tail->next = pos;
+    pos->prev->next = first;
+    pos->prev = tail;
+  }
+  // Merges the null-terminated chain other into chain, keeping the order of
+  // equal elements. If comp throws, chain still holds every node.
+  template <typename Compare>
+  static void merge_chains(BaseNode*& chain, BaseNode* other, Compare& comp) {
+    BaseNode head;
+    BaseNode* tail = &head;
+    BaseNode* node = chain;
+    try {
+      while (node != nullptr && other != nullptr) {
+        if (comp(value_of(other), value_of(node))) {
+          tail->next = other;
+          other = other->next;
+        } else {
+          tail->next = node;
+          node = node->next;
+        }
+        tail = tail->next;
+      }
+    } catch (...) {
+      tail->next = node;
+      chain = head.next;
+      append_chain(chain, other);
+      throw;
+    }
+    tail->next = node != nullptr ? node : other;
+    chain = head.next;
+  }
+  static void append_chain(BaseNode*& chain, BaseNode* other) {
+    BaseNode** tail = &chain;
+    while (*tail != nullptr) {
+      tail = &(*tail)->next;
     }
+    *tail = other;
+  }
+  // Turns a null-terminated chain of all size_ nodes back into the list,
+  // restoring the prev pointers.
+  void relink_chain(BaseNode* chain) {
+    BaseNode* prev = &fake_;
+    for (; chain != nullptr; chain = chain->next) {
+      prev->next = chain;
+      chain->prev = prev;
+      prev = chain;
+    }
+    prev->next = &fake_;
+    fake_.prev = prev;
+  }
+  // The first and last nodes point back at the sentinel, so after fake_ is
+  // copied between lists they have to be redirected to the new one.
+  void relink_fake() {
+    if (size_ == 0) {
+      fake_.prev = fake_.next = &fake_;
+    } else {
+      fake_.next->prev = &fake_;
+      fake_.prev->next = &fake_;
+    }
+  }
+  // Exchanges the nodes only; the allocators stay where they are.
+  void swap_nodes(List& other) noexcept {
     std::swap(fake_, other.fake_);
     std::swap(size_, other.size_);
+    relink_fake();
+    other.relink_fake();
   }
 
  public:
@@ -76,6 +164,11 @@ class List {
     using pointer = std::conditional_t<IsConst, const T*, T*>;
     using reference = std::conditional_t<IsConst, const T&, T&>;
     MyIterator(BaseNode* node) : head_(node) {}
+    operator MyIterator<true>() const
+      requires(!IsConst)
+    {
+      return MyIterator<true>(head_);
+    }
     reference operator*() { return static_cast<Node*>(head_)->value; }
     pointer operator->() const { return &static_cast<Node*>(head_)->value; }
     MyIterator& operator++() {
@@ -105,6 +198,7 @@ class List {
     }
 
    private:
+    friend class List;
     BaseNode* head_;
   };
   using iterator = MyIterator<false>;
@@ -117,7 +211,9 @@ class List {
   }
   iterator end() const { return iterator(const_cast<BaseNode*>(&fake_)); }
   const_iterator cbegin() const { return const_iterator(fake_.next); }
-  const_iterator cend() const { return const_iterator(&fake_); }
+  const_iterator cend() const {
+    return const_iterator(const_cast<BaseNode*>(&fake_));
+  }
   reverse_iterator rbegin() const { return reverse_iterator(end()); }
   reverse_iterator rend() const { return reverse_iterator(begin()); }
   const_reverse_iterator crbegin() const {
@@ -127,95 +223,163 @@ class List {
     return const_reverse_iterator(begin());
   }
   List() = default;
+  explicit List(const Allocator& alloc) : alloc_(alloc) {}
   explicit List(size_t count, const Allocator& alloc = Allocator())
       : alloc_(alloc) {
-    for (size_t i = 0; i < count; ++i) {
-      try {
-        push_back_from_default_value();
-      } catch (...) {
-        while (!empty()) {
-          pop_back();
-        }
-      }
-    }
+    resize(count);
   }
   List(size_t count, const T& value, const Allocator& alloc = Allocator())
       : alloc_(alloc) {
-    for (size_t i = 0; i < count; ++i) {
-      try {
-        push_back(value);
-      } catch (...) {
-        while (!empty()) {
-          pop_back();
-        }
-        throw;
-      }
-    }
+    insert(cend(), count, value);
   }
-  List(std::initializer_list<T> init, const Allocator& alloc = Allocator())
+  template <typename InputIt,
+            typename = std::enable_if_t<!std::is_integral_v<InputIt>>>
+  List(InputIt first, InputIt last, const Allocator& alloc = Allocator())
       : alloc_(alloc) {
-    for (const auto& value : init) {
-      try {
-        push_back(value);
-      } catch (...) {
-        while (!empty()) {
-          pop_back();
-        }
-        throw;
-      }
-    }
+    insert(cend(), first, last);
   }
+  List(std::initializer_list<T> init, const Allocator& alloc = Allocator())
+      : List(init.begin(), init.end(), alloc) {}
   List(const List& other)
-      : size_(0),
-        alloc_(
-            node_traits::select_on_container_copy_construction(other.alloc_)) {
-    for (const auto& value : other) {
-      try {
-        push_back(value);
-      } catch (...) {
-        while (!empty()) {
-          pop_back();
-        }
-        throw;
-      }
-    }
+      : List(other, node_traits::select_on_container_copy_construction(
+                        other.alloc_)) {}
+  List(const List& other, const Allocator& alloc)
+      : List(other.begin(), other.end(), alloc) {}
+  // Takes the nodes over by relinking the sentinel, so it is O(1).
+  List(List&& other) noexcept : alloc_(std::move(other.alloc_)) {
+    swap_nodes(other);
   }
   List& operator=(const List& other) {
-    List temp(other);
-    swap(temp);
-    if (node_traits::propagate_on_container_copy_assignment::value &&
-        alloc_ != other.alloc_) {
-      alloc_ = other.alloc_;
+    if (this != &other) {
+      List temp(other, kPropagateOnCopy ? other.alloc_ : alloc_);
+      swap_nodes(temp);
+      if constexpr (kPropagateOnCopy) {
+        std::swap(alloc_, temp.alloc_);
+      }
     }
     return *this;
   }
-
-  ~List() {
-    while (!empty()) {
-      pop_back();
+  // O(1) unless the allocators differ and do not propagate; then the nodes
+  // cannot change hands and the elements are moved one by one.
+  List& operator=(List&& other) noexcept(kPropagateOnMove ||
+                                         node_traits::is_always_equal::value) {
+    if (this == &other) {
+      return *this;
     }
-  }
-  void push_back(const T& value) {
-    Node* new_node = node_traits::allocate(alloc_, 1);
-    try {
-      node_traits::construct(alloc_, new_node, value);
-    } catch (...) {
-      node_traits::deallocate(alloc_, new_node, 1);
-      throw;
+    clear();
+    if constexpr (kPropagateOnMove) {
+      alloc_ = std::move(other.alloc_);
+    } else if (alloc_ != other.alloc_) {
+      for (auto& value : other) {
+        push_back(std::move(value));
+      }
+      other.clear();
+      return *this;
     }
+    swap_nodes(other);
+    return *this;
+  }
+
+  ~List() { clear(); }
+  void push_back(const T& value) { emplace_back(value); }
+  void push_back(T&& value) { emplace_back(std::move(value)); }
+  void push_front(const T& value) { emplace_front(value); }
+  void push_front(T&& value) { emplace_front(std::move(value)); }
+  template <typename... Args>
+  T& emplace_back(Args&&... args) {
+    Node* new_node = create_node(std::forward<Args>(args)...);
     push_back_balance(new_node);
     ++size_;
+    return new_node->value;
   }
-  void push_front(const T& value) {
-    Node* new_node = node_traits::allocate(alloc_, 1);
-    try {
-      node_traits::construct(alloc_, new_node, value);
-    } catch (...) {
-      node_traits::deallocate(alloc_, new_node, 1);
-      throw;
-    }
+  template <typename... Args>
+  T& emplace_front(Args&&... args) {
+    Node* new_node = create_node(std::forward<Args>(args)...);
     push_front_balance(new_node);
     ++size_;
+    return new_node->value;
+  }
+  template <typename... Args>
+  iterator emplace(const_iterator pos, Args&&... args) {
+    Node* new_node = create_node(std::forward<Args>(args)...);
+    link_before(pos.head_, new_node);
+    ++size_;
+    return iterator(new_node);
+  }
+  iterator insert(const_iterator pos, const T& value) {
+    return emplace(pos, value);
+  }
+  iterator insert(const_iterator pos, T&& value) {
+    return emplace(pos, std::move(value));
+  }
+  // The bulk inserts, assign and resize build all new nodes first; if
+  // anything throws, the list is left unchanged.
+  iterator insert(const_iterator pos, size_t count, const T& value) {
+    return insert_built(pos, [count, &value](List& built) {
+      for (size_t i = 0; i < count; ++i) {
+        built.push_back(value);
+      }
+    });
+  }
+  template <typename InputIt,
+            typename = std::enable_if_t<!std::is_integral_v<InputIt>>>
+  iterator insert(const_iterator pos, InputIt first, InputIt last) {
+    return insert_built(pos, [first, last](List& built) mutable {
+      for (; first != last; ++first) {
+        built.emplace_back(*first);
+      }
+    });
+  }
+  iterator insert(const_iterator pos, std::initializer_list<T> init) {
+    return insert(pos, init.begin(), init.end());
+  }
+  void assign(size_t count, const T& value) {
+    List built(get_allocator());
+    built.insert(built.cend(), count, value);
+    swap_nodes(built);
+  }
+  template <typename InputIt,
+            typename = std::enable_if_t<!std::is_integral_v<InputIt>>>
+  void assign(InputIt first, InputIt last) {
+    List built(get_allocator());
+    built.insert(built.cend(), first, last);
+    swap_nodes(built);
+  }
+  void assign(std::initializer_list<T> init) {
+    assign(init.begin(), init.end());
+  }
+  void resize(size_t count) {
+    if (count <= size_) {
+      shrink_to(count);
+      return;
+    }
+    insert_built(cend(), [count = count - size_](List& built) {
+      for (size_t i = 0; i < count; ++i) {
+        built.emplace_back();
+      }
+    });
+  }
+  void resize(size_t count, const T& value) {
+    if (count <= size_) {
+      shrink_to(count);
+      return;
+    }
+    insert(cend(), count - size_, value);
+  }
+  iterator erase(const_iterator pos) {
+    BaseNode* node = pos.head_;
+    BaseNode* next = node->next;
+    node->prev->next = next;
+    next->prev = node->prev;
+    destroy_node(node);
+    --size_;
+    return iterator(next);
+  }
+  iterator erase(const_iterator first, const_iterator last) {
+    while (first != last) {
+      first = erase(first);
+    }
+    return iterator(last.head_);
   }
   void pop_back() {
     Node* last_node = reinterpret_cast<Node*>(fake_.prev);
@@ -231,7 +395,246 @@ class List {
     node_traits::deallocate(alloc_, first_node, 1);
     --size_;
   }
+  void clear() {
+    while (!empty()) {
+      pop_back();
+    }
+  }
+  // Allocators are exchanged only if they propagate on swap; otherwise they
+  // must compare equal.
+  void swap(List& other) noexcept {
+    swap_nodes(other);
+    if constexpr (node_traits::propagate_on_container_swap::value) {
+      std::swap(alloc_, other.alloc_);
+    }
+  }
+  // The splice, merge and sort family only relinks nodes: no element is
+  // copied, moved or allocated. Lists exchanging nodes must have equal
+  // allocators.
+  void splice(const_iterator pos, List& other) {
+    if (this == &other) {
+      return;
+    }
+    transfer(pos.head_, other.fake_.next, &other.fake_);
+    size_ += other.size_;
+    other.size_ = 0;
+  }
+  void splice(const_iterator pos, List&& other) { splice(pos, other); }
+  void splice(const_iterator pos, List& other, const_iterator it) {
+    transfer(pos.head_, it.head_, it.head_->next);
+    if (this != &other) {
+      ++size_;
+      --other.size_;
+    }
+  }
+  void splice(const_iterator pos, List&& other, const_iterator it) {
+    splice(pos, other, it);
+  }
+  // Linear in the length of the range when other is a different list, as
+  // the sizes have to be updated.
+  void splice(const_iterator pos, List& other, const_iterator first,
+              const_iterator last) {
+    if (this != &other) {
+      const size_t kCount = std::distance(first, last);
+      size_ += kCount;
+      other.size_ -= kCount;
+    }
+    transfer(pos.head_, first.head_, last.head_);
+  }
+  void splice(const_iterator pos, List&& other, const_iterator first,
+              const_iterator last) {
+    splice(pos, other, first, last);
+  }
+  // Both lists must be sorted by comp. Stable: of equal elements, those of
+  // *this come first.
+  template <typename Compare>
+  void merge(List& other, Compare comp) {
+    if (this == &other) {
+      return;
+    }
+    BaseNode* pos = fake_.next;
+    BaseNode* from = other.fake_.next;
+    while (pos != &fake_ && from != &other.fake_) {
+      if (comp(value_of(from), value_of(pos))) {
+        BaseNode* next = from->next;
+        transfer(pos, from, next);
+        from = next;
+        ++size_;
+        --other.size_;
+      } else {
+        pos = pos->next;
+      }
+    }
+    splice(cend(), other);
+  }
+  template <typename Compare>
+  void merge(List&& other, Compare comp) {
+    merge(other, comp);
+  }
+  void merge(List& other) { merge(other, std::less<>()); }
+  void merge(List&& other) { merge(other, std::less<>()); }
+  // Removed nodes are gathered in a local list and destroyed at the end, so
+  // pred may refer to an element of the list.
+  template <typename UnaryPredicate>
+  size_t remove_if(UnaryPredicate pred) {
+    List removed(alloc_);
+    for (BaseNode* node = fake_.next; node != &fake_;) {
+      BaseNode* next = node->next;
+      if (pred(value_of(node))) {
+        removed.splice(removed.cend(), *this, const_iterator(node));
+      }
+      node = next;
+    }
+    return removed.size();
+  }
+  size_t remove(const T& value) {
+    return remove_if([&value](const T& element) { return element == value; });
+  }
+  // Keeps the first element of every run of consecutive equal elements.
+  template <typename BinaryPredicate>
+  size_t unique(BinaryPredicate pred) {
+    if (empty()) {
+      return 0;
+    }
+    List removed(alloc_);
+    for (BaseNode* node = fake_.next; node->next != &fake_;) {
+      BaseNode* next = node->next;
+      if (pred(value_of(node), value_of(next))) {
+        removed.splice(removed.cend(), *this, const_iterator(next));
+      } else {
+        node = next;
+      }
+    }
+    return removed.size();
+  }
+  size_t unique() { return unique(std::equal_to<>()); }
+  void reverse() noexcept {
+    BaseNode* node = &fake_;
+    do {
+      std::swap(node->prev, node->next);
+      node = node->prev;
+    } while (node != &fake_);
+  }
+  // Bottom-up merge sort: bins[k] is either empty or a sorted run of 2^k
+  // nodes, and every node is merged into them like a carry into a binary
+  // counter. Stable. If comp throws, the list keeps all of its elements in
+  // an unspecified order.
+  template <typename Compare>
+  void sort(Compare comp) {
+    if (size_ < 2) {
+      return;
+    }
+    fake_.prev->next = nullptr;
+    BaseNode* rest = fake_.next;
+    BaseNode* run = nullptr;
+    BaseNode* bins[64] = {};
+    size_t used = 0;
+    try {
+      while (rest != nullptr) {
+        run = rest;
+        rest = rest->next;
+        run->next = nullptr;
+        size_t bin = 0;
+        for (; bin < used && bins[bin] != nullptr; ++bin) {
+          BaseNode* carry = run;
+          run = nullptr;
+          merge_chains(bins[bin], carry, comp);
+          run = std::exchange(bins[bin], nullptr);
+        }
+        bins[bin] = std::exchange(run, nullptr);
+        used = std::max(used, bin + 1);
+      }
+      for (size_t bin = 0; bin < used; ++bin) {
+        if (bins[bin] != nullptr) {
+          BaseNode* carry = run;
+          run = nullptr;
+          merge_chains(bins[bin], carry, comp);
+          run = std::exchange(bins[bin], nullptr);
+        }
+      }
+    } catch (...) {
+      // run, the bins and rest hold every node between them.
+      for (BaseNode* part : bins) {
+        append_chain(run, part);
+      }
+      append_chain(run, rest);
+      relink_chain(run);
+      throw;
+    }
+    relink_chain(run);
+  }
+  void sort() { sort(std::less<>()); }
+  // Calls func on every element in order, like a loop over the iterators,
+  // while a second cursor runs distance nodes ahead and prefetches them.
+  // The cursor still chases pointers, but its misses overlap with the work
+  // func does on earlier elements, so this pays off when func is not
+  // trivial and the list is too large to stay in cache.
+  template <typename Func>
+  void for_each_prefetch(Func func, size_t distance = kPrefetchDistance) {
+    prefetch_walk(&fake_, func, distance);
+  }
+  template <typename Func>
+  void for_each_prefetch(Func func,
+                         size_t distance = kPrefetchDistance) const {
+    prefetch_walk(&fake_, [&func](const T& value) { func(value); },
+                  distance);
+  }
   size_t size() const { return size_; }
   bool empty() const { return size() == 0; }
-  node_alloc get_allocator() const { return alloc_; }
+  Allocator get_allocator() const { return Allocator(alloc_); }
+
+ private:
+  template <typename Func>
+  static void prefetch_walk(const BaseNode* fake, Func&& func,
+                            size_t distance) {
+    // Nodes 0..distance-1 are prefetched up front; while node i is
+    // visited, ahead is node i + distance and is prefetched next.
+    BaseNode* ahead = fake->next;
+    for (size_t step = 0; step < distance && ahead != fake; ++step) {
+      prefetch(ahead);
+      ahead = ahead->next;
+    }
+    const bool kLookAhead = distance != 0;
+    for (BaseNode* node = fake->next; node != fake;) {
+      if (kLookAhead && ahead != fake) {
+        prefetch(ahead);
+        ahead = ahead->next;
+      }
+      BaseNode* next = node->next;
+      func(static_cast<Node*>(node)->value);
+      node = next;
+    }
+  }
+  // Lets fill build nodes into a private list, which is then spliced in
+  // front of pos with a single relink. Returns the first new element, or
+  // pos if there is none.
+  template <typename Fill>
+  iterator insert_built(const_iterator pos, Fill fill) {
+    List built(get_allocator());
+    fill(built);
+    iterator first(built.empty() ? pos.head_ : built.fake_.next);
+    splice(pos, built);
+    return first;
+  }
+  void shrink_to(size_t count) {
+    while (size_ > count) {
+      pop_back();
+    }
+  }
+  static constexpr bool kPropagateOnCopy =
+      node_traits::propagate_on_container_copy_assignment::value;
+  static constexpr bool kPropagateOnMove =
+      node_traits::propagate_on_container_move_assignment::value;
 };
+
+template <typename T, typename Allocator>
+void swap(List<T, Allocator>& lhs, List<T, Allocator>& rhs) noexcept {
+  lhs.swap(rhs);
+}
+
+namespace pmr {
+
+template <typename T>
+using List = ::List<T, std::pmr::polymorphic_allocator<T>>;
+
+}  // namespace pmr
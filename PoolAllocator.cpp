@@ -0,0 +1,192 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <type_traits>
+
+// Pool of fixed-size blocks, one per block size and alignment. Memory is
+// taken from the system in slabs that are cut into blocks all at once and
+// never given back, so a block stays valid whichever thread frees it.
+//
+// Every thread allocates from and frees to its own free list without
+// locking. Only when that list runs dry, or grows past kMaxCachedBlocks,
+// does it move a batch of blocks from or to a shared list under a mutex;
+// the blocks left in a thread's list go there when the thread exits.
+// A thread's cache is destroyed before static objects, so a static
+// container freeing or allocating nodes after that is handled too: it
+// goes to the shared list directly.
+template <size_t BlockSize, size_t BlockAlign>
+class SlabPool {
+ public:
+  static void* allocate() {
+    if (cache_destroyed_) {
+      // A temporary cache takes a batch and gives the rest back.
+      Cache cache;
+      return cache.take();
+    }
+    return cache_.take();
+  }
+
+  static void deallocate(void* pointer) noexcept {
+    if (cache_destroyed_) {
+      std::lock_guard lock(mutex_);
+      shared_ = ::new (pointer) FreeBlock{shared_};
+      ++shared_count_;
+      return;
+    }
+    Cache& cache = cache_;
+    cache.head = ::new (pointer) FreeBlock{cache.head};
+    if (++cache.count > kMaxCachedBlocks) {
+      cache.release(kBatchBlocks);
+    }
+  }
+
+ private:
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+
+  struct Slab {
+    Slab* next;
+  };
+
+  struct Cache {
+    FreeBlock* head = nullptr;
+    size_t count = 0;
+
+    ~Cache() { release(count); }
+
+    void* take() {
+      if (head == nullptr) {
+        refill();
+      }
+      FreeBlock* block = head;
+      head = block->next;
+      --count;
+      return block;
+    }
+
+    // Takes a batch from the shared list, or carves a new slab if it is
+    // empty.
+    void refill() {
+      {
+        std::lock_guard lock(mutex_);
+        if (shared_count_ != 0) {
+          head = shared_;
+          count = std::min(shared_count_, kBatchBlocks);
+          FreeBlock* last = head;
+          for (size_t i = 1; i < count; ++i) {
+            last = last->next;
+          }
+          shared_ = last->next;
+          shared_count_ -= count;
+          last->next = nullptr;
+          return;
+        }
+      }
+      auto* memory = static_cast<std::byte*>(
+          ::operator new(kSlabSize, std::align_val_t(kAlign)));
+      {
+        std::lock_guard lock(mutex_);
+        slabs_ = ::new (memory) Slab{slabs_};
+      }
+      for (size_t i = kBlocksPerSlab; i-- != 0;) {
+        head = ::new (memory + kSlabHeaderSize + i * kBlockSize)
+            FreeBlock{head};
+      }
+      count = kBlocksPerSlab;
+    }
+
+    // Moves the first released_count blocks to the shared list.
+    void release(size_t released_count) {
+      if (released_count == 0) {
+        return;
+      }
+      FreeBlock* first = head;
+      FreeBlock* last = head;
+      for (size_t i = 1; i < released_count; ++i) {
+        last = last->next;
+      }
+      head = last->next;
+      count -= released_count;
+      std::lock_guard lock(mutex_);
+      last->next = shared_;
+      shared_ = first;
+      shared_count_ += released_count;
+    }
+  };
+
+  static constexpr size_t kAlign = std::max(BlockAlign, alignof(FreeBlock));
+  static constexpr size_t kBlockSize =
+      (std::max(BlockSize, sizeof(FreeBlock)) + kAlign - 1) / kAlign * kAlign;
+  static constexpr size_t kSlabHeaderSize =
+      (sizeof(Slab) + kAlign - 1) / kAlign * kAlign;
+  static constexpr size_t kBlocksPerSlab =
+      std::max<size_t>((64 * 1024 - kSlabHeaderSize) / kBlockSize, 8);
+  static constexpr size_t kSlabSize =
+      kSlabHeaderSize + kBlocksPerSlab * kBlockSize;
+  static constexpr size_t kBatchBlocks = kBlocksPerSlab;
+  static constexpr size_t kMaxCachedBlocks = 2 * kBatchBlocks;
+
+  // The thread's own cache; marks itself destroyed before ~Cache runs.
+  struct ThreadCache : Cache {
+    ~ThreadCache() { cache_destroyed_ = true; }
+  };
+
+  static inline thread_local ThreadCache cache_;
+  // Trivially destructible, so still readable after cache_ is gone.
+  static inline thread_local bool cache_destroyed_ = false;
+
+  static inline std::mutex mutex_;
+  static inline FreeBlock* shared_ = nullptr;
+  static inline size_t shared_count_ = 0;
+  // Every slab ever allocated, so that they stay reachable.
+  static inline Slab* slabs_ = nullptr;
+};
+
+// Allocator for node-based containers: single objects come from the
+// SlabPool for their size and alignment, arrays from operator new. All
+// instances share the pools, so they always compare equal and containers
+// can exchange nodes freely, e.g. List<T, PoolAllocator<T>>.
+template <typename T>
+class PoolAllocator {
+ public:
+  using value_type = T;
+  using is_always_equal = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+
+  PoolAllocator() noexcept = default;
+
+  template <typename U>
+  PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+  T* allocate(size_t count) {
+    if (count == 1) {
+      return static_cast<T*>(Pool::allocate());
+    }
+    if (count > std::numeric_limits<size_t>::max() / sizeof(T)) {
+      throw std::bad_array_new_length();
+    }
+    return static_cast<T*>(
+        ::operator new(count * sizeof(T), std::align_val_t(alignof(T))));
+  }
+
+  void deallocate(T* pointer, size_t count) noexcept {
+    if (count == 1) {
+      Pool::deallocate(pointer);
+    } else {
+      ::operator delete(pointer, std::align_val_t(alignof(T)));
+    }
+  }
+
+  template <typename U>
+  bool operator==(const PoolAllocator<U>&) const noexcept {
+    return true;
+  }
+
+ private:
+  using Pool = SlabPool<sizeof(T), alignof(T)>;
+};
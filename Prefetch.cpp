@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <xmmintrin.h>
+#endif
+
+// Hints that address will be read soon, so that its cache line is already
+// being fetched by the time a pointer-chasing loop gets there. Never
+// faults, so it may be given any pointer, including nullptr.
+inline void prefetch(const void* address) {
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch(address);
+#elif defined(_MSC_VER)
+  _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#else
+  (void)address;
+#endif
+}
+
+// How many nodes ahead the prefetching traversals look by default: enough
+// to cover a memory access with a few cheap visits, but not so many that
+// the prefetched lines are evicted before they are used.
+inline constexpr size_t kPrefetchDistance = 8;
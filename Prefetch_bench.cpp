@@ -0,0 +1,123 @@
+// Compares plain and prefetching traversals on containers much larger than
+// the last-level cache: List iteration against for_each_prefetch at several
+// distances, BinaryTree forEachInOrder against forEachLevelOrder, and
+// single hasElement calls against hasElements.
+//
+//   g++ -std=c++20 -O2 Prefetch_bench.cpp
+//   ./a.out [list_size] [tree_size] [queries]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <random>
+#include <vector>
+
+#include "List.cpp"
+#include "Tree.cpp"
+
+namespace {
+
+// A few dependent multiplies per element, the kind of work whose latency
+// a look-ahead prefetch can overlap with the next miss.
+uint64_t work(uint64_t value) {
+  for (int i = 0; i < 4; ++i) {
+    value = value * 0x9E3779B97F4A7C15ULL + 1;
+  }
+  return value;
+}
+
+template <typename Func>
+void time(const char* name, size_t count, Func func) {
+  const auto kStart = std::chrono::steady_clock::now();
+  const uint64_t kResult = func();
+  const double kSeconds = std::chrono::duration<double>(
+                              std::chrono::steady_clock::now() - kStart)
+                              .count();
+  std::printf("  %-28s %8.2f ns/element  (%llx)\n", name,
+              kSeconds * 1e9 / count,
+              static_cast<unsigned long long>(kResult & 0xffff));
+}
+
+void listBench(size_t size) {
+  std::mt19937_64 rng(1);
+  List<uint64_t> list;
+  for (size_t i = 0; i < size; ++i) {
+    list.push_back(rng());
+  }
+  // Sorting relinks the nodes by value, so that consecutive nodes end up
+  // at unrelated addresses and every step is a cache miss.
+  list.sort();
+  std::printf("List, %zu nodes\n", size);
+  time("iterator loop", size, [&] {
+    uint64_t sum = 0;
+    for (uint64_t value : list) {
+      sum += work(value);
+    }
+    return sum;
+  });
+  for (size_t distance : {0, 2, 4, 8, 16, 32}) {
+    char name[64];
+    std::snprintf(name, sizeof(name), "for_each_prefetch(%zu)", distance);
+    time(name, size, [&] {
+      uint64_t sum = 0;
+      list.for_each_prefetch(
+          [&sum](uint64_t value) { sum += work(value); }, distance);
+      return sum;
+    });
+  }
+}
+
+void treeBench(size_t size, size_t query_count) {
+  std::mt19937_64 rng(2);
+  BinaryTree<uint64_t> tree;
+  for (size_t i = 0; i < size; ++i) {
+    tree.insert(rng() % (4 * size));
+  }
+  std::vector<uint64_t> queries(query_count);
+  for (uint64_t& query : queries) {
+    query = rng() % (4 * size);
+  }
+  std::printf("BinaryTree, %zu inserts\n", size);
+  time("forEachInOrder", size, [&] {
+    uint64_t sum = 0;
+    tree.forEachInOrder([&sum](uint64_t value) { sum += work(value); });
+    return sum;
+  });
+  time("forEachLevelOrder", size, [&] {
+    uint64_t sum = 0;
+    tree.forEachLevelOrder([&sum](uint64_t value) { sum += work(value); });
+    return sum;
+  });
+  std::printf("BinaryTree, %zu lookups\n", query_count);
+  time("hasElement loop", query_count, [&] {
+    uint64_t found = 0;
+    for (uint64_t query : queries) {
+      found += tree.hasElement(query);
+    }
+    return found;
+  });
+  time("hasElements", query_count, [&] {
+    std::vector<bool> found;
+    found.reserve(queries.size());
+    tree.hasElements(queries.begin(), queries.end(),
+                     std::back_inserter(found));
+    return static_cast<uint64_t>(std::count(found.begin(), found.end(),
+                                            true));
+  });
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t kListSize =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 8'000'000;
+  const size_t kTreeSize =
+      argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 4'000'000;
+  const size_t kQueries =
+      argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 2'000'000;
+  listBench(kListSize);
+  treeBench(kTreeSize, kQueries);
+}
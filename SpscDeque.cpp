@@ -0,0 +1,239 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "Deque.cpp"
+
+// Single-producer/single-consumer queue on the chunked layout of Deque:
+// elements live in arrays of ArraySize, linked front to back. The producer
+// only writes tail_ and the consumer only writes head_; each publishes its
+// position with a release store and reads the other's with an acquire
+// load, so no operation ever blocks. Emptied arrays are handed back to the
+// producer through a one-slot cache instead of being freed.
+//
+// One thread may call the producer side (try_push, try_emplace) and one
+// thread the consumer side (try_pop) at the same time. The allocator is
+// used from both threads.
+template <typename T, typename Allocator = std::allocator<T>,
+          size_t ArraySize = kDequeArraySize<T>>
+class SpscDeque {
+  static_assert(std::has_single_bit(ArraySize) && ArraySize >= 2,
+                "SpscDeque array size must be a power of two");
+
+ public:
+  // A max_size of 0 makes the queue unbounded; otherwise pushes fail once
+  // max_size elements are queued.
+  explicit SpscDeque(size_t max_size = 0, const Allocator& alloc = Allocator())
+      : alloc_(alloc), block_alloc_(alloc), max_size_(max_size) {
+    head_block_ = tail_block_ = new_block();
+  }
+
+  SpscDeque(const SpscDeque&) = delete;
+  SpscDeque& operator=(const SpscDeque&) = delete;
+
+  ~SpscDeque() {
+    const size_t kTail = tail_.load(std::memory_order_acquire);
+    for (size_t head = head_.load(std::memory_order_relaxed); head != kTail;
+         ++head) {
+      array_traits::destroy(alloc_, pop_slot(head));
+    }
+    for (Block* block = head_block_; block != nullptr;) {
+      Block* next = block->next.load(std::memory_order_relaxed);
+      delete_block(block);
+      block = next;
+    }
+    delete_block(spare_.load(std::memory_order_relaxed));
+  }
+
+  // Producer side.
+
+  template <typename... Args>
+  bool try_emplace(Args&&... args) {
+    const size_t kTail = tail_.load(std::memory_order_relaxed);
+    if (room(kTail, 1) == 0) {
+      return false;
+    }
+    emplace_at(kTail, std::forward<Args>(args)...);
+    tail_.store(kTail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool try_push(const T& value) { return try_emplace(value); }
+
+  bool try_push(T&& value) { return try_emplace(std::move(value)); }
+
+  // Pushes as much of [first, last) as fits and publishes it with a single
+  // store. Returns the iterator past the last element pushed.
+  template <typename InputIt>
+  InputIt try_push(InputIt first, InputIt last) {
+    const size_t kTail = tail_.load(std::memory_order_relaxed);
+    size_t tail = kTail;
+    const size_t kRoom = room(kTail, max_size_ == 0 ? SIZE_MAX : max_size_);
+    try {
+      for (; first != last && tail - kTail != kRoom; ++first, ++tail) {
+        emplace_at(tail, *first);
+      }
+    } catch (...) {
+      tail_.store(tail, std::memory_order_release);
+      throw;
+    }
+    tail_.store(tail, std::memory_order_release);
+    return first;
+  }
+
+  // Consumer side.
+
+  bool try_pop(T& value) {
+    const size_t kHead = head_.load(std::memory_order_relaxed);
+    if (available(kHead, 1) == 0) {
+      return false;
+    }
+    T* slot = pop_slot(kHead);
+    value = std::move(*slot);
+    array_traits::destroy(alloc_, slot);
+    head_.store(kHead + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Pops up to max_count elements into out and releases their slots with a
+  // single store. Returns the number of elements popped.
+  template <typename OutputIt>
+  size_t try_pop(OutputIt out, size_t max_count) {
+    const size_t kHead = head_.load(std::memory_order_relaxed);
+    const size_t kCount = available(kHead, max_count);
+    for (size_t head = kHead; head != kHead + kCount; ++head) {
+      T* slot = pop_slot(head);
+      *out = std::move(*slot);
+      ++out;
+      array_traits::destroy(alloc_, slot);
+    }
+    head_.store(kHead + kCount, std::memory_order_release);
+    return kCount;
+  }
+
+  // Exact only when neither side is running.
+  [[nodiscard]] size_t size() const {
+    const size_t kHead = head_.load(std::memory_order_acquire);
+    return tail_.load(std::memory_order_acquire) - kHead;
+  }
+
+  [[nodiscard]] bool empty() const { return size() == 0; }
+
+ private:
+  struct Block {
+    std::atomic<Block*> next{nullptr};
+    alignas(T) unsigned char storage[sizeof(T) * ArraySize];
+
+    T* slot(size_t index) {
+      return std::launder(reinterpret_cast<T*>(storage)) + index;
+    }
+  };
+
+  // How many of wanted elements fit after tail. Rereads head_ only when
+  // the cached copy says the queue is full.
+  size_t room(size_t tail, size_t wanted) {
+    if (max_size_ == 0) {
+      return wanted;
+    }
+    if (tail - cached_head_ + wanted > max_size_) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+    }
+    return std::min(wanted, max_size_ - (tail - cached_head_));
+  }
+
+  // How many of wanted elements are queued from head on. Rereads tail_
+  // only when the cached copy says the queue is empty.
+  size_t available(size_t head, size_t wanted) {
+    if (cached_tail_ - head < wanted) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+    }
+    return std::min(wanted, cached_tail_ - head);
+  }
+
+  // Constructs the element at position tail. The first element of a new
+  // array is built before the array is linked, so a throwing constructor
+  // leaves the chain untouched.
+  template <typename... Args>
+  void emplace_at(size_t tail, Args&&... args) {
+    const size_t kInArray = tail & (ArraySize - 1);
+    if (kInArray != 0 || tail == 0) {
+      array_traits::construct(alloc_, tail_block_->slot(kInArray),
+                              std::forward<Args>(args)...);
+      return;
+    }
+    Block* block = spare_.exchange(nullptr, std::memory_order_acquire);
+    if (block == nullptr) {
+      block = new_block();
+    }
+    block->next.store(nullptr, std::memory_order_relaxed);
+    try {
+      array_traits::construct(alloc_, block->slot(0),
+                              std::forward<Args>(args)...);
+    } catch (...) {
+      recycle(block);
+      throw;
+    }
+    tail_block_->next.store(block, std::memory_order_release);
+    tail_block_ = block;
+  }
+
+  // Slot of the element at position head; steps to the next array when
+  // head is the first position of it.
+  T* pop_slot(size_t head) {
+    const size_t kInArray = head & (ArraySize - 1);
+    if (kInArray == 0 && head != 0) {
+      Block* next = head_block_->next.load(std::memory_order_acquire);
+      recycle(head_block_);
+      head_block_ = next;
+    }
+    return head_block_->slot(kInArray);
+  }
+
+  void recycle(Block* block) {
+    delete_block(spare_.exchange(block, std::memory_order_acq_rel));
+  }
+
+  Block* new_block() {
+    Block* block = block_traits::allocate(block_alloc_, 1);
+    block_traits::construct(block_alloc_, block);
+    return block;
+  }
+
+  void delete_block(Block* block) {
+    if (block != nullptr) {
+      block_traits::destroy(block_alloc_, block);
+      block_traits::deallocate(block_alloc_, block, 1);
+    }
+  }
+
+  using allocator_traits = std::allocator_traits<Allocator>;
+  using allocator = typename allocator_traits::template rebind_alloc<T>;
+  using array_traits = std::allocator_traits<allocator>;
+  using block_allocator =
+      typename allocator_traits::template rebind_alloc<Block>;
+  using block_traits = std::allocator_traits<block_allocator>;
+
+  static constexpr size_t kCacheLineSize = 64;
+
+  // Producer-owned.
+  alignas(kCacheLineSize) std::atomic<size_t> tail_{0};
+  Block* tail_block_ = nullptr;
+  size_t cached_head_ = 0;
+
+  // Consumer-owned.
+  alignas(kCacheLineSize) std::atomic<size_t> head_{0};
+  Block* head_block_ = nullptr;
+  size_t cached_tail_ = 0;
+
+  alignas(kCacheLineSize) std::atomic<Block*> spare_{nullptr};
+  allocator alloc_;
+  block_allocator block_alloc_;
+  const size_t max_size_;
+};
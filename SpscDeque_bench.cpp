@@ -0,0 +1,129 @@
+// Passes N integers from a producer thread to a consumer thread through a
+// mutex-wrapped Deque, SpscDeque one element at a time, and SpscDeque in
+// batches, and prints the throughput of each.
+//
+//   g++ -std=c++20 -O2 -pthread SpscDeque_bench.cpp && ./a.out [N]
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Deque.cpp"
+#include "SpscDeque.cpp"
+
+namespace {
+
+constexpr size_t kBatch = 64;
+
+template <typename Produce, typename Consume>
+void run(const char* name, size_t count, Produce produce, Consume consume) {
+  const auto kStart = std::chrono::steady_clock::now();
+  std::thread producer(produce);
+  const uint64_t kSum = consume();
+  producer.join();
+  const double kSeconds = std::chrono::duration<double>(
+                              std::chrono::steady_clock::now() - kStart)
+                              .count();
+  const uint64_t kExpected = uint64_t{count} * (count - 1) / 2;
+  std::printf("%-24s %8.2f Mitems/s %7.2f ns/item%s\n", name,
+              count / kSeconds / 1e6, kSeconds * 1e9 / count,
+              kSum == kExpected ? "" : "  WRONG SUM");
+}
+
+void mutexDeque(size_t count) {
+  Deque<uint64_t> deque;
+  std::mutex mutex;
+  run(
+      "mutex + Deque", count,
+      [&] {
+        for (uint64_t i = 0; i < count; ++i) {
+          std::lock_guard lock(mutex);
+          deque.push_back(i);
+        }
+      },
+      [&] {
+        uint64_t sum = 0;
+        for (size_t received = 0; received < count;) {
+          std::unique_lock lock(mutex);
+          if (deque.empty()) {
+            lock.unlock();
+            std::this_thread::yield();
+            continue;
+          }
+          sum += deque[0];
+          deque.pop_front();
+          ++received;
+        }
+        return sum;
+      });
+}
+
+void spscSingle(size_t count) {
+  SpscDeque<uint64_t> queue;
+  run(
+      "SpscDeque", count,
+      [&] {
+        for (uint64_t i = 0; i < count; ++i) {
+          queue.try_push(i);
+        }
+      },
+      [&] {
+        uint64_t sum = 0;
+        uint64_t value = 0;
+        for (size_t received = 0; received < count;) {
+          if (queue.try_pop(value)) {
+            sum += value;
+            ++received;
+          } else {
+            std::this_thread::yield();
+          }
+        }
+        return sum;
+      });
+}
+
+void spscBatched(size_t count) {
+  SpscDeque<uint64_t> queue;
+  run(
+      "SpscDeque, batches of 64", count,
+      [&] {
+        uint64_t batch[kBatch];
+        for (uint64_t i = 0; i < count;) {
+          const size_t kSize = std::min<uint64_t>(kBatch, count - i);
+          for (size_t j = 0; j < kSize; ++j) {
+            batch[j] = i + j;
+          }
+          queue.try_push(batch, batch + kSize);
+          i += kSize;
+        }
+      },
+      [&] {
+        uint64_t sum = 0;
+        uint64_t batch[kBatch];
+        for (size_t received = 0; received < count;) {
+          const size_t kPopped = queue.try_pop(batch, kBatch);
+          if (kPopped == 0) {
+            std::this_thread::yield();
+          }
+          for (size_t j = 0; j < kPopped; ++j) {
+            sum += batch[j];
+          }
+          received += kPopped;
+        }
+        return sum;
+      });
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t kCount = argc > 1 ? std::strtoull(argv[1], nullptr, 10)
+                                 : size_t{10'000'000};
+  mutexDeque(kCount);
+  spscSingle(kCount);
+  spscBatched(kCount);
+}
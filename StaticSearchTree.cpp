@@ -0,0 +1,281 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <concepts>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <type_traits>
+#include <vector>
+
+#include "Prefetch.cpp"
+#include "Tree.cpp"
+
+/// <h1> StaticSearchTree Declaration
+/// <b> read-only snapshot of a sorted set in Eytzinger order: the array is
+/// <b> the implicit complete binary search tree stored level by level, so
+/// <b> the node at 1-based index k has children 2k and 2k + 1. A descent
+/// <b> is a loop of index arithmetic with no pointer to chase and no branch
+/// <b> on the keys, and the top levels, which every lookup reads, share a
+/// <b> few cache lines. Rebuild it from the mutable tree when that changes.
+template <std::totally_ordered T, typename Allocator = std::allocator<T>>
+class StaticSearchTree {
+ public:
+  using value_type = T;
+  using allocator_type = Allocator;
+
+  StaticSearchTree() = default;
+  explicit StaticSearchTree(const Allocator&);
+
+  /// <b> snapshot of the values of 'tree'
+  template <typename TreeAllocator>
+  explicit StaticSearchTree(const BinaryTree<T, TreeAllocator>& tree,
+                            const Allocator& alloc = Allocator());
+
+  /// <b> snapshot of the ascending values of [first, last); equal
+  /// <b> neighbours are dropped
+  template <std::forward_iterator InputIt>
+    requires std::is_lvalue_reference_v<std::iter_reference_t<InputIt>>
+  StaticSearchTree(InputIt first, InputIt last,
+                   const Allocator& alloc = Allocator());
+
+  bool hasElement(const T&) const;
+
+  /// <b> first value not less than 'value', or nullptr if there is none
+  const T* lowerBound(const T& value) const;
+
+  const T& min() const;
+  const T& max() const;
+
+  /// <b> batch versions: answer every query of [first, last) in order and
+  /// <b> write the answers to out; kLookupGroup descents run interleaved,
+  /// <b> so their cache misses overlap instead of queueing
+  template <std::forward_iterator InputIt, typename OutputIt>
+  OutputIt hasElements(InputIt first, InputIt last, OutputIt out) const;
+  template <std::forward_iterator InputIt, typename OutputIt>
+  OutputIt lowerBounds(InputIt first, InputIt last, OutputIt out) const;
+
+  size_t size() const;
+  bool empty() const;
+
+ private:
+  /// <b> lay out the values 'sorted' points to
+  void build(const std::vector<const T*>& sorted);
+
+  /// <b> 1-based index of the answer of a finished descent that ended
+  /// <b> at 'k', 0 if every value is less than the query
+  static size_t finish(size_t k);
+
+  /// <b> value at 1-based index k
+  const T& at(size_t k) const;
+
+  /// <b> run the interleaved descents, calling emit(query, finished index)
+  /// <b> for each query in order
+  template <std::forward_iterator InputIt, typename Emit>
+  void lookupBatch(InputIt first, InputIt last, Emit emit) const;
+
+  static constexpr size_t kCacheLine = 64;
+  /// <b> the descendants of node k that are log2(kPrefetchSpan) levels
+  /// <b> down are the kPrefetchSpan slots from k * kPrefetchSpan on; the
+  /// <b> span is a cache line of keys, so one prefetch covers the node the
+  /// <b> descent will reach that many steps later
+  static constexpr size_t kPrefetchSpan =
+      std::bit_floor(std::max<size_t>(1, kCacheLine / sizeof(T)));
+  static constexpr size_t kLookupGroup = 16;
+
+  std::vector<T, Allocator> keys_;
+  size_t min_index_{0};
+  size_t max_index_{0};
+};
+
+/// <b> Eytzinger snapshot of 'tree' for read-mostly lookups
+template <std::totally_ordered T, typename Allocator>
+StaticSearchTree<T, Allocator> freeze(const BinaryTree<T, Allocator>& tree) {
+  return StaticSearchTree<T, Allocator>(tree);
+}
+
+/// <h1> StaticSearchTree Implementation
+
+template <std::totally_ordered T, typename Allocator>
+StaticSearchTree<T, Allocator>::StaticSearchTree(const Allocator& alloc)
+    : keys_(alloc) {}
+
+template <std::totally_ordered T, typename Allocator>
+template <typename TreeAllocator>
+StaticSearchTree<T, Allocator>::StaticSearchTree(
+    const BinaryTree<T, TreeAllocator>& tree, const Allocator& alloc)
+    : keys_(alloc) {
+  std::vector<const T*> sorted;
+  tree.forEachInOrder([&sorted](const T& value) {
+    sorted.push_back(&value);
+  });
+  build(sorted);
+}
+
+template <std::totally_ordered T, typename Allocator>
+template <std::forward_iterator InputIt>
+  requires std::is_lvalue_reference_v<std::iter_reference_t<InputIt>>
+StaticSearchTree<T, Allocator>::StaticSearchTree(InputIt first, InputIt last,
+                                                 const Allocator& alloc)
+    : keys_(alloc) {
+  std::vector<const T*> sorted;
+  for (; first != last; ++first) {
+    if (sorted.empty() || *sorted.back() < *first) {
+      sorted.push_back(std::addressof(*first));
+    }
+  }
+  build(sorted);
+}
+
+template <std::totally_ordered T, typename Allocator>
+bool StaticSearchTree<T, Allocator>::hasElement(const T& value) const {
+  const T* bound = lowerBound(value);
+  return bound != nullptr && !(value < *bound);
+}
+
+template <std::totally_ordered T, typename Allocator>
+const T* StaticSearchTree<T, Allocator>::lowerBound(const T& value) const {
+  const size_t kSize = keys_.size();
+  const T* keys = keys_.data();
+  size_t k = 1;
+  while (k <= kSize) {
+    // Slot 0 always exists and prefetching it is harmless, which keeps the
+    // address computation free of branches.
+    const size_t kAhead = k * kPrefetchSpan;
+    prefetch(keys + (kAhead <= kSize ? kAhead - 1 : 0));
+    k = 2 * k + static_cast<size_t>(keys[k - 1] < value);
+  }
+  k = finish(k);
+  return k == 0 ? nullptr : &at(k);
+}
+
+template <std::totally_ordered T, typename Allocator>
+const T& StaticSearchTree<T, Allocator>::min() const {
+  return at(min_index_);
+}
+
+template <std::totally_ordered T, typename Allocator>
+const T& StaticSearchTree<T, Allocator>::max() const {
+  return at(max_index_);
+}
+
+template <std::totally_ordered T, typename Allocator>
+template <std::forward_iterator InputIt, typename OutputIt>
+OutputIt StaticSearchTree<T, Allocator>::hasElements(InputIt first,
+                                                     InputIt last,
+                                                     OutputIt out) const {
+  lookupBatch(first, last, [&](const InputIt& query, size_t k) {
+    *out++ = k != 0 && !(*query < at(k));
+  });
+  return out;
+}
+
+template <std::totally_ordered T, typename Allocator>
+template <std::forward_iterator InputIt, typename OutputIt>
+OutputIt StaticSearchTree<T, Allocator>::lowerBounds(InputIt first,
+                                                     InputIt last,
+                                                     OutputIt out) const {
+  lookupBatch(first, last, [&](const InputIt&, size_t k) {
+    *out++ = k == 0 ? nullptr : &at(k);
+  });
+  return out;
+}
+
+template <std::totally_ordered T, typename Allocator>
+size_t StaticSearchTree<T, Allocator>::size() const {
+  return keys_.size();
+}
+
+template <std::totally_ordered T, typename Allocator>
+bool StaticSearchTree<T, Allocator>::empty() const {
+  return keys_.empty();
+}
+
+template <std::totally_ordered T, typename Allocator>
+void StaticSearchTree<T, Allocator>::build(
+    const std::vector<const T*>& sorted) {
+  const size_t kSize = sorted.size();
+  // An in-order walk of the implicit tree visits the slots in ascending
+  // order, so it tells which sorted value goes to which slot.
+  std::vector<size_t> rank_of_slot(kSize);
+  std::vector<size_t> stack;
+  size_t rank = 0;
+  for (size_t k = 1; k <= kSize || !stack.empty();) {
+    if (k <= kSize) {
+      stack.push_back(k);
+      k *= 2;
+      continue;
+    }
+    k = stack.back();
+    stack.pop_back();
+    rank_of_slot[k - 1] = rank++;
+    k = 2 * k + 1;
+  }
+  keys_.reserve(kSize);
+  for (size_t slot = 0; slot < kSize; ++slot) {
+    keys_.push_back(*sorted[rank_of_slot[slot]]);
+  }
+  if (kSize != 0) {
+    min_index_ = std::bit_floor(kSize);
+    max_index_ = std::bit_floor(kSize + 1) - 1;
+  }
+}
+
+template <std::totally_ordered T, typename Allocator>
+size_t StaticSearchTree<T, Allocator>::finish(size_t k) {
+  // The descent went right (appended a 1 bit) after every node less than
+  // the query; the answer is the last node where it went left, found by
+  // dropping the trailing ones and that left turn.
+  return k >> (std::countr_one(k) + 1);
+}
+
+template <std::totally_ordered T, typename Allocator>
+const T& StaticSearchTree<T, Allocator>::at(size_t k) const {
+  return keys_[k - 1];
+}
+
+template <std::totally_ordered T, typename Allocator>
+template <std::forward_iterator InputIt, typename Emit>
+void StaticSearchTree<T, Allocator>::lookupBatch(InputIt first, InputIt last,
+                                                 Emit emit) const {
+  const size_t kSize = keys_.size();
+  const T* keys = keys_.data();
+  // Every descent passes the bit_width(n) - 1 full levels, and some go
+  // one step further into the last, partial level.
+  const size_t kFullLevels =
+      kSize == 0 ? 0 : static_cast<size_t>(std::bit_width(kSize)) - 1;
+  InputIt queries[kLookupGroup];
+  size_t nodes[kLookupGroup];
+  while (first != last) {
+    size_t count = 0;
+    for (; count < kLookupGroup && first != last; ++count, ++first) {
+      queries[count] = first;
+      nodes[count] = 1;
+    }
+    for (size_t level = 0; level < kFullLevels; ++level) {
+      for (size_t i = 0; i < count; ++i) {
+        const size_t kNode = nodes[i];
+        const bool kRight = keys[kNode - 1] < *queries[i];
+        nodes[i] = 2 * kNode + static_cast<size_t>(kRight);
+        prefetch(keys + std::min(nodes[i], kSize) - 1);
+      }
+    }
+    for (size_t i = 0; i < count; ++i) {
+      size_t k = nodes[i];
+      if (k <= kSize) {
+        k = 2 * k + static_cast<size_t>(keys[k - 1] < *queries[i]);
+      }
+      emit(queries[i], finish(k));
+    }
+  }
+}
+
+namespace pmr {
+
+/// <b> StaticSearchTree whose array comes from a memory_resource
+template <std::totally_ordered T>
+using StaticSearchTree =
+    ::StaticSearchTree<T, std::pmr::polymorphic_allocator<T>>;
+
+}  // namespace pmr
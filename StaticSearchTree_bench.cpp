@@ -0,0 +1,134 @@
+// Lookups in a StaticSearchTree (Eytzinger array) against the BinaryTree
+// it was frozen from, on random 64-bit keys: single lookups, batched
+// lookups, and dependent lookups whose next query waits for the previous
+// answer. Also times freeze(). The default size puts the array, and the
+// tree even more so, beyond the last-level cache.
+//
+//   g++ -std=c++20 -O2 StaticSearchTree_bench.cpp
+//   ./a.out [keys] [lookups]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <random>
+#include <vector>
+
+#include "StaticSearchTree.cpp"
+#include "Tree.cpp"
+
+namespace {
+
+template <typename Func>
+void time(const char* name, size_t count, const char* unit, Func func) {
+  const auto kStart = std::chrono::steady_clock::now();
+  const uint64_t kResult = func();
+  const double kSeconds = std::chrono::duration<double>(
+                              std::chrono::steady_clock::now() - kStart)
+                              .count();
+  std::printf("  %-32s %8.1f ns/%s  (%llu)\n", name,
+              kSeconds * 1e9 / count, unit,
+              static_cast<unsigned long long>(kResult));
+}
+
+// found grows by 0 or 1 per query, so each query depends on the answer
+// to the one before it.
+template <typename Lookup>
+uint64_t dependent(const std::vector<uint64_t>& queries, Lookup lookup) {
+  uint64_t found = 0;
+  for (size_t i = 0; i < queries.size(); ++i) {
+    found += lookup(queries[(i + found) % queries.size()]);
+  }
+  return found;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t kKeys =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 16'000'000;
+  const size_t kLookups =
+      argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 4'000'000;
+
+  // Even keys, inserted in order with an end() hint; the queries hit
+  // about half of the time.
+  BinaryTree<uint64_t> tree;
+  for (size_t i = 0; i < kKeys; ++i) {
+    tree.insert(tree.end(), 2 * i);
+  }
+  std::mt19937_64 rng(1);
+  std::vector<uint64_t> queries(kLookups);
+  for (uint64_t& query : queries) {
+    query = rng() % (2 * kKeys);
+  }
+  std::printf("%zu keys, %zu lookups\n", kKeys, kLookups);
+
+  StaticSearchTree<uint64_t> frozen;
+  time("freeze", kKeys, "key", [&] {
+    frozen = freeze(tree);
+    return frozen.size();
+  });
+
+  std::printf("independent lookups\n");
+  time("BinaryTree::hasElement", kLookups, "lookup", [&] {
+    uint64_t found = 0;
+    for (uint64_t query : queries) {
+      found += tree.hasElement(query);
+    }
+    return found;
+  });
+  time("StaticSearchTree::hasElement", kLookups, "lookup", [&] {
+    uint64_t found = 0;
+    for (uint64_t query : queries) {
+      found += frozen.hasElement(query);
+    }
+    return found;
+  });
+  time("StaticSearchTree::lowerBound", kLookups, "lookup", [&] {
+    uint64_t sum = 0;
+    for (uint64_t query : queries) {
+      const uint64_t* bound = frozen.lowerBound(query);
+      sum += bound != nullptr ? *bound - query : 0;
+    }
+    return sum;
+  });
+
+  std::printf("batched lookups\n");
+  std::vector<bool> found;
+  found.reserve(kLookups);
+  time("BinaryTree::hasElements", kLookups, "lookup", [&] {
+    found.clear();
+    tree.hasElements(queries.begin(), queries.end(),
+                     std::back_inserter(found));
+    return std::count(found.begin(), found.end(), true);
+  });
+  time("StaticSearchTree::hasElements", kLookups, "lookup", [&] {
+    found.clear();
+    frozen.hasElements(queries.begin(), queries.end(),
+                       std::back_inserter(found));
+    return std::count(found.begin(), found.end(), true);
+  });
+  std::vector<const uint64_t*> bounds(kLookups);
+  time("StaticSearchTree::lowerBounds", kLookups, "lookup", [&] {
+    frozen.lowerBounds(queries.begin(), queries.end(), bounds.begin());
+    uint64_t sum = 0;
+    for (size_t i = 0; i < kLookups; ++i) {
+      sum += bounds[i] != nullptr ? *bounds[i] - queries[i] : 0;
+    }
+    return sum;
+  });
+
+  std::printf("dependent lookups\n");
+  time("BinaryTree::hasElement", kLookups, "lookup", [&] {
+    return dependent(queries, [&](uint64_t query) {
+      return tree.hasElement(query);
+    });
+  });
+  time("StaticSearchTree::hasElement", kLookups, "lookup", [&] {
+    return dependent(queries, [&](uint64_t query) {
+      return frozen.hasElement(query);
+    });
+  });
+}
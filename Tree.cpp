@@ -1,10 +1,22 @@
+#pragma once
+
+#include <concepts>
 #include <iostream>
+#include <iterator>
 #include <memory>
+#include <memory_resource>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Prefetch.cpp"
 
 /// <h1> Interface Declaration
 template <std::totally_ordered T>
 class SearchTree {
  public:
+  virtual ~SearchTree() = default;
+
   virtual void insert(const T&) = 0;
   virtual void insert(T&&) = 0;
 
@@ -14,53 +26,139 @@ class SearchTree {
   virtual T& min() = 0;
   virtual T& max() = 0;
 
-  virtual bool hasElement() const = 0;
+  virtual bool hasElement(const T&) const = 0;
 };
 
 /// <h1> BinaryTree Declaration
-template <std::totally_ordered T>
+/// <b> AVL tree: the heights of the two subtrees of every node differ by at
+/// <b> most one, so every operation is O(log n) even for sorted input;
+/// <b> the tree owns its nodes, which link to each other by raw pointers
+template <std::totally_ordered T, typename Allocator = std::allocator<T>>
 class BinaryTree : public SearchTree<T> {
  public:
+  using value_type = T;
+  using allocator_type = Allocator;
+
+  class Iterator;
+  /// <b> in-order iterators; values can't be changed through them, and
+  /// <b> remove() invalidates them
+  using iterator = Iterator;
+  using const_iterator = Iterator;
+
   BinaryTree() = default;
+  explicit BinaryTree(const Allocator&);
   BinaryTree(const BinaryTree&);
   BinaryTree(BinaryTree&&);
+  ~BinaryTree() override;
 
   void insert(const T&) override;
   void insert(T&&) override;
 
+  /// <b> hinted insert: O(1) amortized when the value goes right before
+  /// <b> 'hint' or right after it, as with sorted input and hint end();
+  /// <b> otherwise a normal insert
+  iterator insert(const_iterator hint, const T&);
+  iterator insert(const_iterator hint, T&&);
+
+  /// <b> single descent; the node is built only once the value is known to
+  /// <b> be missing. Returns the element with the value and whether it was
+  /// <b> inserted
   template<typename ...Args>
-  void emplace(Args&&... args);
+  std::pair<iterator, bool> emplace(Args&&... args);
 
+  template<typename ...Args>
+  iterator emplaceHint(const_iterator hint, Args&&... args);
+
+  /// <b> removes the value at the root
   void remove() override;
   void remove(T) override;
 
   T& min() override;
   T& max() override;
 
-  bool hasElement(T&) const override;
+  bool hasElement(const T&) const override;
+
+  /// <b> writes hasElement(value) for every value of [first, last) to out;
+  /// <b> runs kLookupGroup searches in lockstep, prefetching the next node
+  /// <b> of each, so that their cache misses overlap
+  template <std::forward_iterator InputIt, typename OutputIt>
+  OutputIt hasElements(InputIt first, InputIt last, OutputIt out) const;
+
+  /// <b> calls func on every value in ascending order; the right child of
+  /// <b> each node is prefetched when the node is stacked
+  template <typename Func>
+  void forEachInOrder(Func func) const;
+
+  /// <b> calls func on every value level by level from the root; children
+  /// <b> are prefetched as soon as they are queued
+  template <typename Func>
+  void forEachLevelOrder(Func func) const;
 
   BinaryTree getLeftSubtree();
   BinaryTree getRightSubtree();
 
   T top();
 
+  iterator begin() const;
+  iterator end() const;
+
  private:
   class Node;
-  using NodePtr = std::shared_ptr<Node>;
-  using NodeWeakPtr = std::weak_ptr<Node>;
+  using NodePtr = Node*;
+  using NodeAllocator = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<Node>;
+  using NodeTraits = std::allocator_traits<NodeAllocator>;
 
-  NodePtr getMaxNode(NodePtr);
-  NodePtr getMinNode(NodePtr);
+  /// <b> allocate and construct a detached node
+  template <typename ...Args>
+  NodePtr createNode(Args&&... args);
+
+  /// <b> destroy and free a single node, not its children
+  void destroyNode(NodePtr);
+
+  /// <b> destroy 'node' and every node below it
+  void destroySubtree(NodePtr node);
+
+  /// <b> deep copy of the subtree at 'node', which may be nullptr
+  NodePtr copySubtree(const Node* node);
+
+  static NodePtr getMaxNode(NodePtr);
+  static NodePtr getMinNode(NodePtr);
+  NodePtr findNode(const T&) const;
+
+  /// <b> insert 'value' unless an equal one is present, in one descent
+  template <typename V>
+  std::pair<iterator, bool> insertUnique(V&& value);
 
-  BinaryTree(const NodePtr&);
+  template <typename V>
+  iterator insertHint(const_iterator hint, V&& value);
 
+  /// <b> build a node from 'value' and hang it below 'parent', which has a
+  /// <b> free slot on that side, or make it the root if 'parent' is nullptr
+  template <typename V>
+  iterator attach(NodePtr parent, bool as_left, V&& value);
+
+  /// <b> rotate the subtree at 'node' and return its new root
+  NodePtr rotateLeft(NodePtr node);
+  NodePtr rotateRight(NodePtr node);
+
+  /// <b> restore heights and balance from 'node' up to the root
+  void rebalance(NodePtr node);
+
+  /// <b> takes ownership of the subtree at the node
+  BinaryTree(NodePtr, const NodeAllocator&);
+
+  static constexpr size_t kLookupGroup = 16;
+
+  NodeAllocator alloc_;
   NodePtr root_{nullptr};
+  /// <b> node with the max value, so that end() - 1 is O(1)
+  NodePtr rightmost_{nullptr};
 };
 
 /// <h1> Node Declaration
-template <std::totally_ordered T>
-class BinaryTree<T>::Node :
-        public std::enable_shared_from_this<BinaryTree<T>::Node> {
+template <std::totally_ordered T, typename Allocator>
+class BinaryTree<T, Allocator>::Node {
  public:
   /// <b> base constructors
   Node(const T&);
@@ -76,272 +174,675 @@ class BinaryTree<T>::Node :
   /// <b> get left child
   NodePtr getRight() const;
 
-  /// <b> creates shared_ptr on node's parent
+  /// <b> get parent, nullptr for the root
   NodePtr getRoot() const;
 
   /// <b> returns value, contained by this node
   T& getValue();
   const T& getValue() const;
 
-  /// <b> set left/right child
-  void setLeft(const NodePtr&);
-  void setRight(const NodePtr&);
+  /// <b> set left/right child, which may be nullptr
+  void setLeft(NodePtr);
+  void setRight(NodePtr);
 
-  /// <b> swap node with 'other' (only pointers)
+  /// <b> swap node with 'other' (only values)
   void swap(Node& other);
 
-  /// <b> create copy of node and of it's subtree
-  NodePtr getCopy() const;
-
   /// <b> true if node don't have children
   bool isLeaf() const;
 
-  /// <b> destroy this node
+  /// <b> height of the subtree at this node; a leaf has height 1
+  int getHeight() const;
+
+  /// <b> recompute height from the children
+  void updateHeight();
+
+  /// <b> height of left subtree minus height of right subtree
+  int getBalance() const;
+
+  /// <b> put 'node' (may be nullptr) in place of this node under its parent
+  void replaceWith(NodePtr node);
+
+  /// <b> unlink this node from its parent
   void reset();
 
  private:
-  using Base = std::enable_shared_from_this<Node>;
-
   T value_;
-  bool is_left_child_{false};
+  int height_{1};
 
   NodePtr left_{nullptr};
   NodePtr right_{nullptr};
-  NodeWeakPtr parent_;
+  NodePtr parent_{nullptr};
+};
+
+/// <h1> Iterator Declaration
+template <std::totally_ordered T, typename Allocator>
+class BinaryTree<T, Allocator>::Iterator {
+ public:
+  using iterator_category = std::bidirectional_iterator_tag;
+  using difference_type = std::ptrdiff_t;
+  using value_type = T;
+  using pointer = const T*;
+  using reference = const T&;
+
+  Iterator() = default;
+
+  reference operator*() const;
+  pointer operator->() const;
+
+  /// <b> in-order successor, climbing parent links when needed
+  Iterator& operator++();
+  Iterator operator++(int);
+
+  /// <b> in-order predecessor; end() steps back to the max
+  Iterator& operator--();
+  Iterator operator--(int);
+
+  bool operator==(const Iterator&) const = default;
+
+ private:
+  friend class BinaryTree;
+
+  Iterator(NodePtr node, const BinaryTree* tree);
+
+  /// <b> nullptr for end()
+  NodePtr node_{nullptr};
+  const BinaryTree* tree_{nullptr};
 };
 
 /// <h1> Node Implementation </h1>
-template <std::totally_ordered T>
-BinaryTree<T>::Node::Node(const T& value) : value_(value) {}
+template <std::totally_ordered T, typename Allocator>
+BinaryTree<T, Allocator>::Node::Node(const T& value) : value_(value) {}
 
-template <std::totally_ordered T>
-BinaryTree<T>::Node::Node(T&& value) : value_(std::move(value)) {}
+template <std::totally_ordered T, typename Allocator>
+BinaryTree<T, Allocator>::Node::Node(T&& value) : value_(std::move(value)) {}
 
-template <std::totally_ordered T>
+template <std::totally_ordered T, typename Allocator>
 template <typename ...Args>
-BinaryTree<T>::Node::Node(Args&&... args)
+BinaryTree<T, Allocator>::Node::Node(Args&&... args)
     : value_(std::forward<Args>(args)...) {}
 
-template <std::totally_ordered T>
-typename BinaryTree<T>::NodePtr BinaryTree<T>::Node::getLeft() const {
+template <std::totally_ordered T, typename Allocator>
+typename BinaryTree<T, Allocator>::NodePtr
+BinaryTree<T, Allocator>::Node::getLeft() const {
   return left_;
 }
 
-template <std::totally_ordered T>
-typename BinaryTree<T>::NodePtr BinaryTree<T>::Node::getRight() const {
+template <std::totally_ordered T, typename Allocator>
+typename BinaryTree<T, Allocator>::NodePtr
+BinaryTree<T, Allocator>::Node::getRight() const {
   return right_;
 }
 
-template <std::totally_ordered T>
-typename BinaryTree<T>::NodePtr BinaryTree<T>::Node::getRoot() const {
-  return parent_.lock();
+template <std::totally_ordered T, typename Allocator>
+typename BinaryTree<T, Allocator>::NodePtr
+BinaryTree<T, Allocator>::Node::getRoot() const {
+  return parent_;
 }
 
-template <std::totally_ordered T>
-T& BinaryTree<T>::Node::getValue() { return value_; }
+template <std::totally_ordered T, typename Allocator>
+T& BinaryTree<T, Allocator>::Node::getValue() { return value_; }
 
-template <std::totally_ordered T>
-const T& BinaryTree<T>::Node::getValue() const { return value_; }
+template <std::totally_ordered T, typename Allocator>
+const T& BinaryTree<T, Allocator>::Node::getValue() const { return value_; }
 
-template <std::totally_ordered T>
-void BinaryTree<T>::Node::setLeft(const NodePtr& node) {
+template <std::totally_ordered T, typename Allocator>
+void BinaryTree<T, Allocator>::Node::setLeft(NodePtr node) {
   left_ = node;
-  node->parent_ = std::weak_ptr(Base::shared_from_this());
-  node->is_left_child_ = true;
+  if (node != nullptr) {
+    node->parent_ = this;
+  }
 }
 
-template <std::totally_ordered T>
-void BinaryTree<T>::Node::setRight(const NodePtr& node) {
+template <std::totally_ordered T, typename Allocator>
+void BinaryTree<T, Allocator>::Node::setRight(NodePtr node) {
   right_ = node;
-  node->parent_ = std::weak_ptr(Base::shared_from_this());
-  node->is_left_child_ = false;
+  if (node != nullptr) {
+    node->parent_ = this;
+  }
 }
 
-template <std::totally_ordered T>
-void BinaryTree<T>::Node::swap(BinaryTree<T>::Node& other) {
+template <std::totally_ordered T, typename Allocator>
+void BinaryTree<T, Allocator>::Node::swap(Node& other) {
   std::swap(value_, other.value_);
 }
 
-template <std::totally_ordered T>
-typename BinaryTree<T>::NodePtr BinaryTree<T>::Node::getCopy() const {
-  NodePtr node = std::make_shared(value_);
-  if (left_ != nullptr) {
-    node.left_ = left_.getCopy();
-    node.left_->parent_ = std::weak_ptr(Base::shared_from_this());
+template <std::totally_ordered T, typename Allocator>
+bool BinaryTree<T, Allocator>::Node::isLeaf() const {
+  return getLeft() == nullptr && getRight() == nullptr;
+}
+
+template <std::totally_ordered T, typename Allocator>
+int BinaryTree<T, Allocator>::Node::getHeight() const {
+  return height_;
+}
+
+template <std::totally_ordered T, typename Allocator>
+void BinaryTree<T, Allocator>::Node::updateHeight() {
+  const int kLeft = left_ == nullptr ? 0 : left_->height_;
+  const int kRight = right_ == nullptr ? 0 : right_->height_;
+  height_ = 1 + (kLeft < kRight ? kRight : kLeft);
+}
+
+template <std::totally_ordered T, typename Allocator>
+int BinaryTree<T, Allocator>::Node::getBalance() const {
+  return (left_ == nullptr ? 0 : left_->height_) -
+         (right_ == nullptr ? 0 : right_->height_);
+}
+
+template <std::totally_ordered T, typename Allocator>
+void BinaryTree<T, Allocator>::Node::replaceWith(NodePtr node) {
+  if (node != nullptr) {
+    node->parent_ = parent_;
   }
-  if (right_ != nullptr) {
-    node.right_ = right_.getCopy();
-    node.right_->parent_ = std::weak_ptr(Base::shared_from_this());
+  if (parent_ != nullptr) {
+    (parent_->left_ == this ? parent_->left_ : parent_->right_) = node;
   }
-  return node
+  parent_ = nullptr;
 }
 
-template <std::totally_ordered T>
-bool BinaryTree<T>::Node::isLeaf() const {
-  return getLeft() == nullptr && getRight() == nullptr;
+template <std::totally_ordered T, typename Allocator>
+void BinaryTree<T, Allocator>::Node::reset() {
+  replaceWith(nullptr);
 }
 
-template <std::totally_ordered T>
-void BinaryTree<T>::Node::reset() {
-  NodePtr parent = getParent();
-  if (is_left_child_) {
-    parent->getLeft().reset();
-  } else {
-    parent->getRight().reset();
+/// <h1> Iterator Implementation
+
+template <std::totally_ordered T, typename Allocator>
+BinaryTree<T, Allocator>::Iterator::Iterator(NodePtr node,
+                                             const BinaryTree* tree)
+    : node_(node), tree_(tree) {}
+
+template <std::totally_ordered T, typename Allocator>
+const T& BinaryTree<T, Allocator>::Iterator::operator*() const {
+  return node_->getValue();
+}
+
+template <std::totally_ordered T, typename Allocator>
+const T* BinaryTree<T, Allocator>::Iterator::operator->() const {
+  return &node_->getValue();
+}
+
+template <std::totally_ordered T, typename Allocator>
+typename BinaryTree<T, Allocator>::Iterator&
+BinaryTree<T, Allocator>::Iterator::operator++() {
+  if (node_->getRight() != nullptr) {
+    node_ = getMinNode(node_->getRight());
+    return *this;
+  }
+  while (node_->getRoot() != nullptr && node_->getRoot()->getRight() == node_) {
+    node_ = node_->getRoot();
+  }
+  node_ = node_->getRoot();
+  return *this;
+}
+
+template <std::totally_ordered T, typename Allocator>
+typename BinaryTree<T, Allocator>::Iterator
+BinaryTree<T, Allocator>::Iterator::operator++(int) {
+  Iterator old = *this;
+  ++*this;
+  return old;
+}
+
+template <std::totally_ordered T, typename Allocator>
+typename BinaryTree<T, Allocator>::Iterator&
+BinaryTree<T, Allocator>::Iterator::operator--() {
+  if (node_ == nullptr) {
+    node_ = tree_->rightmost_;
+    return *this;
+  }
+  if (node_->getLeft() != nullptr) {
+    node_ = getMaxNode(node_->getLeft());
+    return *this;
   }
+  while (node_->getRoot() != nullptr && node_->getRoot()->getLeft() == node_) {
+    node_ = node_->getRoot();
+  }
+  node_ = node_->getRoot();
+  return *this;
+}
+
+template <std::totally_ordered T, typename Allocator>
+typename BinaryTree<T, Allocator>::Iterator
+BinaryTree<T, Allocator>::Iterator::operator--(int) {
+  Iterator old = *this;
+  --*this;
+  return old;
 }
 
 /// <h1> BinaryTree Implementation
 
-template <std::totally_ordered T>
-BinaryTree<T>::BinaryTree(const BinaryTree& other) : root_(other.root_->getCopy()) {}
+template <std::totally_ordered T, typename Allocator>
+BinaryTree<T, Allocator>::BinaryTree(const Allocator& alloc) : alloc_(alloc) {}
 
-template <std::totally_ordered T>
-BinaryTree<T>::BinaryTree(BinaryTree<T>&& other) : root_(std::move(other.root_)) {}
+template <std::totally_ordered T, typename Allocator>
+BinaryTree<T, Allocator>::BinaryTree(const BinaryTree& other)
+    : alloc_(NodeTraits::select_on_container_copy_construction(other.alloc_)),
+      root_(copySubtree(other.root_)),
+      rightmost_(root_ == nullptr ? nullptr : getMaxNode(root_)) {}
 
-template <std::totally_ordered T>
-void BinaryTree<T>::insert(const T& value) { emplace(value); }
+template <std::totally_ordered T, typename Allocator>
+BinaryTree<T, Allocator>::BinaryTree(BinaryTree<T, Allocator>&& other)
+    : alloc_(std::move(other.alloc_)),
+      root_(std::exchange(other.root_, nullptr)),
+      rightmost_(std::exchange(other.rightmost_, nullptr)) {}
 
-template <std::totally_ordered T>
-void BinaryTree<T>::insert(T&& value) { emplace(std::move(value)); }
+template <std::totally_ordered T, typename Allocator>
+BinaryTree<T, Allocator>::~BinaryTree() {
+  destroySubtree(root_);
+}
 
-template <std::totally_ordered T>
+template <std::totally_ordered T, typename Allocator>
+void BinaryTree<T, Allocator>::insert(const T& value) { emplace(value); }
+
+template <std::totally_ordered T, typename Allocator>
+void BinaryTree<T, Allocator>::insert(T&& value) { emplace(std::move(value)); }
+
+template <std::totally_ordered T, typename Allocator>
+typename BinaryTree<T, Allocator>::iterator
+BinaryTree<T, Allocator>::insert(const_iterator hint, const T& value) {
+  return insertHint(hint, value);
+}
+
+template <std::totally_ordered T, typename Allocator>
+typename BinaryTree<T, Allocator>::iterator
+BinaryTree<T, Allocator>::insert(const_iterator hint, T&& value) {
+  return insertHint(hint, std::move(value));
+}
+
+template <std::totally_ordered T, typename Allocator>
 template <typename ...Args>
-void BinaryTree<T>::emplace(Args&&... args) {
-  NodePtr node = std::make_shared<Node>(std::forward<Args>(args)...);
-  if (hasElement(node->getValue())) {
-    return;
+std::pair<typename BinaryTree<T, Allocator>::iterator, bool>
+BinaryTree<T, Allocator>::emplace(Args&&... args) {
+  if constexpr (sizeof...(Args) == 1 &&
+                (std::is_same_v<std::remove_cvref_t<Args>, T> && ...)) {
+    return insertUnique(std::forward<Args>(args)...);
+  } else {
+    // The value is needed to search, so build it on the stack and move it
+    // into a node only if it is missing.
+    return insertUnique(T(std::forward<Args>(args)...));
   }
-  NodePtr current = root_;
-  while (!current.isLeaf()) {
-    if (current->getValue() < node->getValue()) {
-      if (current->getRight() == nullptr) {
-        current->setRight(*node);
-        return;
-      }
+}
+
+template <std::totally_ordered T, typename Allocator>
+template <typename ...Args>
+typename BinaryTree<T, Allocator>::iterator
+BinaryTree<T, Allocator>::emplaceHint(const_iterator hint, Args&&... args) {
+  if constexpr (sizeof...(Args) == 1 &&
+                (std::is_same_v<std::remove_cvref_t<Args>, T> && ...)) {
+    return insertHint(hint, std::forward<Args>(args)...);
+  } else {
+    return insertHint(hint, T(std::forward<Args>(args)...));
+  }
+}
+
+template <std::totally_ordered T, typename Allocator>
+template <typename V>
+std::pair<typename BinaryTree<T, Allocator>::iterator, bool>
+BinaryTree<T, Allocator>::insertUnique(V&& value) {
+  NodePtr parent = nullptr;
+  bool as_left = false;
+  for (NodePtr current = root_; current != nullptr;) {
+    parent = current;
+    if (value < current->getValue()) {
+      as_left = true;
+      current = current->getLeft();
+    } else if (current->getValue() < value) {
+      as_left = false;
       current = current->getRight();
+    } else {
+      return {iterator(current, this), false};
     }
-    if (current->getLeft() == nullptr) {
-      current->setLeft(*node);
-      return;
-    }
-    current = current->getLeft();
   }
-  if (current->getValue() < node->getValue()) {
-    current->setRight(*node);
+  return {attach(parent, as_left, std::forward<V>(value)), true};
+}
+
+template <std::totally_ordered T, typename Allocator>
+template <typename V>
+typename BinaryTree<T, Allocator>::iterator
+BinaryTree<T, Allocator>::insertHint(const_iterator hint, V&& value) {
+  // Find the neighbours 'prev' < value < 'next' around the hint, where
+  // nullptr stands for no bound; if the hint is off, search from the root.
+  NodePtr next = hint.node_;
+  NodePtr prev = nullptr;
+  if (next != nullptr && !(value < next->getValue())) {
+    if (!(next->getValue() < value)) {
+      return hint;
+    }
+    prev = next;
+    next = (++hint).node_;
+    if (next != nullptr && !(value < next->getValue())) {
+      return insertUnique(std::forward<V>(value)).first;
+    }
   } else {
-    current->setLeft(*node);
+    prev = (--hint).node_;
+    if (prev != nullptr && !(prev->getValue() < value)) {
+      return insertUnique(std::forward<V>(value)).first;
+    }
+  }
+  // Of two in-order neighbours, either the first has no right child or
+  // the second has no left child.
+  if (prev != nullptr && prev->getRight() == nullptr) {
+    return attach(prev, false, std::forward<V>(value));
   }
+  return attach(next, true, std::forward<V>(value));
 }
 
-template <std::totally_ordered T>
-void BinaryTree<T>::remove() {
-  if (root_ == nullptr) {
-    return;
+template <std::totally_ordered T, typename Allocator>
+template <typename V>
+typename BinaryTree<T, Allocator>::iterator
+BinaryTree<T, Allocator>::attach(NodePtr parent, bool as_left, V&& value) {
+  NodePtr node = createNode(std::forward<V>(value));
+  if (parent == nullptr) {
+    root_ = rightmost_ = node;
+    return iterator(node, this);
   }
-  NodePtr current = root_;
-  while (!current->isLeaf()) {
-    if (current->getLeft() != nullptr) {
-      current = getMaxNode(current->getLeft());
-      continue;
-    }
-    if (current->getRight() != nullptr) {
-      current = getMaxNode(current->getRight());
-      continue;
+  if (as_left) {
+    parent->setLeft(node);
+  } else {
+    parent->setRight(node);
+    if (parent == rightmost_) {
+      rightmost_ = node;
     }
   }
-  current->reset();
+  rebalance(parent);
+  return iterator(node, this);
 }
 
-template <std::totally_ordered T>
-void BinaryTree<T>::remove(T value) {
-  if (!hasElement(value)) {
+template <std::totally_ordered T, typename Allocator>
+void BinaryTree<T, Allocator>::remove() {
+  if (root_ != nullptr) {
+    remove(root_->getValue());
+  }
+}
+
+template <std::totally_ordered T, typename Allocator>
+void BinaryTree<T, Allocator>::remove(T value) {
+  NodePtr node_to_delete = findNode(value);
+  if (node_to_delete == nullptr) {
     return;
   }
-  NodePtr node_to_delete = root_;
-  while (!node_to_delete->getValue() != value) {
-    if (node_to_delete->getValue() < value) {
-      node_to_delete = node_to_delete->getRight();
-      continue;
-    }
-    node_to_delete = node_to_delete->getLeft();
+  if (node_to_delete->getLeft() != nullptr &&
+      node_to_delete->getRight() != nullptr) {
+    NodePtr max_node = getMaxNode(node_to_delete->getLeft());
+    node_to_delete->swap(*max_node);
+    node_to_delete = max_node;
   }
-  NodePtr current = node_to_delete;
-  while (!current->isLeaf()) {
-    if (current->getLeft() != nullptr) {
-      current = getMaxNode(current->getLeft());
-      continue;
-    }
-    if (current->getRight() != nullptr) {
-      current = getMaxNode(current->getRight());
-      continue;
-    }
+  NodePtr child = node_to_delete->getLeft() != nullptr
+                      ? node_to_delete->getLeft()
+                      : node_to_delete->getRight();
+  NodePtr parent = node_to_delete->getRoot();
+  if (node_to_delete == rightmost_) {
+    rightmost_ = child != nullptr ? getMaxNode(child) : parent;
   }
-  current->reset();
+  if (node_to_delete == root_) {
+    root_ = child;
+  }
+  node_to_delete->replaceWith(child);
+  destroyNode(node_to_delete);
+  rebalance(parent);
 }
 
-template <std::totally_ordered T>
-T& BinaryTree<T>::min() {
-  return getMinNode(root_).get();
+template <std::totally_ordered T, typename Allocator>
+T& BinaryTree<T, Allocator>::min() {
+  return getMinNode(root_)->getValue();
 }
 
-template <std::totally_ordered T>
-T& BinaryTree<T>::max() {
-  return getMaxNode(root_).get();
+template <std::totally_ordered T, typename Allocator>
+T& BinaryTree<T, Allocator>::max() {
+  return rightmost_->getValue();
 }
 
-template <std::totally_ordered T>
-bool BinaryTree<T>::hasElement(T& value) const {
-  if (root_ == nullptr) {
-    return false;
-  }
-  NodePtr current = root_;
-  while (current->getValue() != value) {
-    if (current->getValue() < value) {
-      if (current->getRight() == nullptr) {
-        return false;
+template <std::totally_ordered T, typename Allocator>
+bool BinaryTree<T, Allocator>::hasElement(const T& value) const {
+  return findNode(value) != nullptr;
+}
+
+template <std::totally_ordered T, typename Allocator>
+template <std::forward_iterator InputIt, typename OutputIt>
+OutputIt BinaryTree<T, Allocator>::hasElements(InputIt first, InputIt last,
+                                              OutputIt out) const {
+  InputIt values[kLookupGroup];
+  const Node* nodes[kLookupGroup];
+  while (first != last) {
+    size_t count = 0;
+    for (; count < kLookupGroup && first != last; ++count, ++first) {
+      values[count] = first;
+      nodes[count] = root_;
+    }
+    // Each round moves every unfinished search one level down; a search
+    // is finished when its node is null or holds the value.
+    bool searching = true;
+    while (searching) {
+      searching = false;
+      for (size_t i = 0; i < count; ++i) {
+        const Node* node = nodes[i];
+        if (node == nullptr || node->getValue() == *values[i]) {
+          continue;
+        }
+        node = node->getValue() < *values[i] ? node->getRight()
+                                             : node->getLeft();
+        prefetch(node);
+        nodes[i] = node;
+        searching = true;
       }
-      current = current->getRight();
-      continue;
     }
-    if (current->getLeft() == nullptr) {
-      return false;
+    for (size_t i = 0; i < count; ++i) {
+      *out++ = nodes[i] != nullptr;
     }
-    current = current->getLeft();
   }
-  return true;
+  return out;
 }
 
-template <std::totally_ordered T>
-T BinaryTree<T>::top() {
+template <std::totally_ordered T, typename Allocator>
+template <typename Func>
+void BinaryTree<T, Allocator>::forEachInOrder(Func func) const {
+  std::vector<const Node*> stack;
+  const Node* node = root_;
+  while (node != nullptr || !stack.empty()) {
+    for (; node != nullptr; node = node->getLeft()) {
+      prefetch(node->getRight());
+      stack.push_back(node);
+    }
+    node = stack.back();
+    stack.pop_back();
+    func(node->getValue());
+    node = node->getRight();
+  }
+}
+
+template <std::totally_ordered T, typename Allocator>
+template <typename Func>
+void BinaryTree<T, Allocator>::forEachLevelOrder(Func func) const {
+  std::vector<const Node*> level;
+  std::vector<const Node*> next_level;
+  if (root_ != nullptr) {
+    level.push_back(root_);
+  }
+  while (!level.empty()) {
+    for (const Node* node : level) {
+      for (const Node* child : {node->getLeft(), node->getRight()}) {
+        if (child != nullptr) {
+          prefetch(child);
+          next_level.push_back(child);
+        }
+      }
+      func(node->getValue());
+    }
+    level.swap(next_level);
+    next_level.clear();
+  }
+}
+
+template <std::totally_ordered T, typename Allocator>
+T BinaryTree<T, Allocator>::top() {
   return root_->getValue();
 }
 
-template <std::totally_ordered T>
-BinaryTree<T> BinaryTree<T>::getLeftSubtree() {
-  return root_->getleft()->getCopy();
+template <std::totally_ordered T, typename Allocator>
+typename BinaryTree<T, Allocator>::iterator
+BinaryTree<T, Allocator>::begin() const {
+  return iterator(root_ == nullptr ? nullptr : getMinNode(root_), this);
 }
 
-template <std::totally_ordered T>
-BinaryTree<T> BinaryTree<T>::getRightSubtree() {
-  return root_->getRight()->getCopy();
+template <std::totally_ordered T, typename Allocator>
+typename BinaryTree<T, Allocator>::iterator
+BinaryTree<T, Allocator>::end() const {
+  return iterator(nullptr, this);
 }
 
-template <std::totally_ordered T>
-BinaryTree<T>::BinaryTree(const BinaryTree::NodePtr& node) : root_(node) {}
+template <std::totally_ordered T, typename Allocator>
+BinaryTree<T, Allocator> BinaryTree<T, Allocator>::getLeftSubtree() {
+  return BinaryTree(copySubtree(root_->getLeft()), alloc_);
+}
 
-template <std::totally_ordered T>
-NodePtr BinaryTree<T>::getMinNode(BinaryTree::NodePtr node) {
+template <std::totally_ordered T, typename Allocator>
+BinaryTree<T, Allocator> BinaryTree<T, Allocator>::getRightSubtree() {
+  return BinaryTree(copySubtree(root_->getRight()), alloc_);
+}
+
+template <std::totally_ordered T, typename Allocator>
+BinaryTree<T, Allocator>::BinaryTree(NodePtr node,
+                                     const NodeAllocator& alloc)
+    : alloc_(alloc),
+      root_(node),
+      rightmost_(node == nullptr ? nullptr : getMaxNode(node)) {}
+
+template <std::totally_ordered T, typename Allocator>
+template <typename ...Args>
+typename BinaryTree<T, Allocator>::NodePtr
+BinaryTree<T, Allocator>::createNode(Args&&... args) {
+  NodePtr node = NodeTraits::allocate(alloc_, 1);
+  try {
+    NodeTraits::construct(alloc_, node, std::forward<Args>(args)...);
+  } catch (...) {
+    NodeTraits::deallocate(alloc_, node, 1);
+    throw;
+  }
+  return node;
+}
+
+template <std::totally_ordered T, typename Allocator>
+void BinaryTree<T, Allocator>::destroyNode(NodePtr node) {
+  NodeTraits::destroy(alloc_, node);
+  NodeTraits::deallocate(alloc_, node, 1);
+}
+
+template <std::totally_ordered T, typename Allocator>
+void BinaryTree<T, Allocator>::destroySubtree(NodePtr node) {
+  if (node != nullptr) {
+    destroySubtree(node->getLeft());
+    destroySubtree(node->getRight());
+    destroyNode(node);
+  }
+}
+
+template <std::totally_ordered T, typename Allocator>
+typename BinaryTree<T, Allocator>::NodePtr
+BinaryTree<T, Allocator>::copySubtree(const Node* node) {
+  if (node == nullptr) {
+    return nullptr;
+  }
+  NodePtr copy = createNode(node->getValue());
+  try {
+    copy->setLeft(copySubtree(node->getLeft()));
+    copy->setRight(copySubtree(node->getRight()));
+  } catch (...) {
+    destroySubtree(copy);
+    throw;
+  }
+  copy->updateHeight();
+  return copy;
+}
+
+template <std::totally_ordered T, typename Allocator>
+typename BinaryTree<T, Allocator>::NodePtr
+BinaryTree<T, Allocator>::getMinNode(BinaryTree::NodePtr node) {
   while (node->getLeft() != nullptr) {
     node = node->getLeft();
   }
   return node;
 }
 
-template <std::totally_ordered T>
-NodePtr BinaryTree<T>::getMaxNode(BinaryTree::NodePtr node) {
+template <std::totally_ordered T, typename Allocator>
+typename BinaryTree<T, Allocator>::NodePtr
+BinaryTree<T, Allocator>::getMaxNode(BinaryTree::NodePtr node) {
   while (node->getRight() != nullptr) {
     node = node->getRight();
   }
   return node;
 }
+
+template <std::totally_ordered T, typename Allocator>
+typename BinaryTree<T, Allocator>::NodePtr
+BinaryTree<T, Allocator>::findNode(const T& value) const {
+  NodePtr current = root_;
+  while (current != nullptr && current->getValue() != value) {
+    current = current->getValue() < value ? current->getRight()
+                                          : current->getLeft();
+  }
+  return current;
+}
+
+template <std::totally_ordered T, typename Allocator>
+typename BinaryTree<T, Allocator>::NodePtr
+BinaryTree<T, Allocator>::rotateLeft(NodePtr node) {
+  NodePtr pivot = node->getRight();
+  if (node == root_) {
+    root_ = pivot;
+  }
+  node->replaceWith(pivot);
+  node->setRight(pivot->getLeft());
+  pivot->setLeft(node);
+  node->updateHeight();
+  pivot->updateHeight();
+  return pivot;
+}
+
+template <std::totally_ordered T, typename Allocator>
+typename BinaryTree<T, Allocator>::NodePtr
+BinaryTree<T, Allocator>::rotateRight(NodePtr node) {
+  NodePtr pivot = node->getLeft();
+  if (node == root_) {
+    root_ = pivot;
+  }
+  node->replaceWith(pivot);
+  node->setLeft(pivot->getRight());
+  pivot->setRight(node);
+  node->updateHeight();
+  pivot->updateHeight();
+  return pivot;
+}
+
+template <std::totally_ordered T, typename Allocator>
+void BinaryTree<T, Allocator>::rebalance(NodePtr node) {
+  while (node != nullptr) {
+    const int kOldHeight = node->getHeight();
+    node->updateHeight();
+    if (node->getBalance() > 1) {
+      if (node->getLeft()->getBalance() < 0) {
+        rotateLeft(node->getLeft());
+      }
+      node = rotateRight(node);
+    } else if (node->getBalance() < -1) {
+      if (node->getRight()->getBalance() > 0) {
+        rotateRight(node->getRight());
+      }
+      node = rotateLeft(node);
+    }
+    // Ancestors only depend on the height of this subtree.
+    if (node->getHeight() == kOldHeight) {
+      return;
+    }
+    node = node->getRoot();
+  }
+}
+
+namespace pmr {
+
+/// <b> BinaryTree whose nodes come from a memory_resource
+template <std::totally_ordered T>
+using BinaryTree = ::BinaryTree<T, std::pmr::polymorphic_allocator<T>>;
+
+}  // namespace pmr
@@ -0,0 +1,105 @@
+// Insertion throughput of the AVL BinaryTree against a plain unbalanced
+// binary search tree, the shape BinaryTree had before it was balanced, for
+// sorted and random keys. Sorted keys turn the unbalanced tree into a
+// list and make n inserts take O(n^2) steps, so for that order it only
+// runs at a quarter, half and all of max_unbalanced_sorted keys; both
+// trees also run at min_keys, 10 * min_keys, ... up to max_keys.
+//
+//   g++ -std=c++20 -O2 Tree_bench.cpp
+//   ./a.out [min_keys] [max_keys] [max_unbalanced_sorted]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "Tree.cpp"
+
+namespace {
+
+// Unbalanced search tree: every key goes to the leaf position its
+// descent ends at. Nodes are owned by a vector so that a degenerate tree
+// is destroyed without recursion.
+class UnbalancedTree {
+ public:
+  void insert(uint64_t value) {
+    Node** link = &root_;
+    while (*link != nullptr) {
+      if (value == (*link)->value) {
+        return;
+      }
+      link = value < (*link)->value ? &(*link)->left : &(*link)->right;
+    }
+    nodes_.push_back(std::make_unique<Node>(value));
+    *link = nodes_.back().get();
+  }
+
+  size_t size() const { return nodes_.size(); }
+
+ private:
+  struct Node {
+    explicit Node(uint64_t value) : value(value) {}
+    uint64_t value;
+    Node* left = nullptr;
+    Node* right = nullptr;
+  };
+
+  Node* root_ = nullptr;
+  std::vector<std::unique_ptr<Node>> nodes_;
+};
+
+template <typename Tree>
+void bench(const char* name, const std::vector<uint64_t>& keys) {
+  const auto kStart = std::chrono::steady_clock::now();
+  Tree tree;
+  for (uint64_t key : keys) {
+    tree.insert(key);
+  }
+  const double kSeconds = std::chrono::duration<double>(
+                              std::chrono::steady_clock::now() - kStart)
+                              .count();
+  std::printf("  %-12s %10.3f Minserts/s\n", name,
+              keys.size() / kSeconds / 1e6);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t kMinKeys =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1'000'000;
+  const size_t kMaxKeys =
+      argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 10'000'000;
+  const size_t kMaxUnbalancedSorted =
+      argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 50'000;
+
+  std::vector<size_t> counts = {kMaxUnbalancedSorted / 4,
+                                kMaxUnbalancedSorted / 2,
+                                kMaxUnbalancedSorted};
+  for (size_t count = std::max<size_t>(kMinKeys, 1); count <= kMaxKeys;
+       count *= 10) {
+    counts.push_back(count);
+  }
+  std::mt19937_64 rng(1);
+  for (const bool kSorted : {true, false}) {
+    std::printf("%s keys\n", kSorted ? "sorted" : "random");
+    for (size_t count : counts) {
+      std::vector<uint64_t> keys(count);
+      std::iota(keys.begin(), keys.end(), 0);
+      if (!kSorted) {
+        std::shuffle(keys.begin(), keys.end(), rng);
+      }
+      std::printf(" %zu keys\n", count);
+      bench<BinaryTree<uint64_t>>("AVL", keys);
+      if (!kSorted || count <= kMaxUnbalancedSorted) {
+        bench<UnbalancedTree>("unbalanced", keys);
+      } else {
+        std::printf("  %-12s    skipped (quadratic)\n", "unbalanced");
+      }
+    }
+  }
+}
@@ -0,0 +1,427 @@
+#pragma once
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Default number of elements per node: a node fills about 256 bytes.
+template <typename T>
+inline constexpr size_t kUnrolledListNodeSize =
+    std::max<size_t>((256 - 3 * sizeof(void*)) / sizeof(T), 4);
+
+// Doubly linked list whose nodes hold up to N elements each, so the two
+// link pointers are paid once per node and a scan touches consecutive
+// memory. A full node is split in half to make room for an insertion;
+// after an erase, a node that has dropped below half is merged with its
+// successor when both fit in one node. Elements move inside and between
+// neighbouring nodes, so insert and erase invalidate iterators into the
+// nodes involved.
+template <typename T, size_t N = kUnrolledListNodeSize<T>,
+          typename Allocator = std::allocator<T>>
+class UnrolledList {
+  static_assert(N >= 2, "UnrolledList nodes must hold at least 2 elements");
+
+ private:
+  struct BaseNode {
+    BaseNode* prev = this;
+    BaseNode* next = this;
+  };
+
+  struct Node : BaseNode {
+    size_t count = 0;
+    alignas(T) unsigned char storage[sizeof(T) * N];
+
+    T* slot(size_t index) {
+      return std::launder(reinterpret_cast<T*>(storage)) + index;
+    }
+  };
+
+  BaseNode fake_;
+  size_t size_ = 0;
+  using node_alloc =
+      typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+  using node_traits = typename std::allocator_traits<node_alloc>;
+  node_alloc alloc_;
+
+  static constexpr size_t kHalf = N / 2;
+  static constexpr bool kPropagateOnCopy =
+      node_traits::propagate_on_container_copy_assignment::value;
+  static constexpr bool kPropagateOnMove =
+      node_traits::propagate_on_container_move_assignment::value;
+
+ public:
+  using value_type = T;
+  using allocator_type = Allocator;
+  template <bool IsConst>
+  class MyIterator {
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = std::conditional_t<IsConst, const T, T>;
+    using pointer = std::conditional_t<IsConst, const T*, T*>;
+    using reference = std::conditional_t<IsConst, const T&, T&>;
+    MyIterator(BaseNode* node, size_t index) : node_(node), index_(index) {}
+    operator MyIterator<true>() const
+      requires(!IsConst)
+    {
+      return MyIterator<true>(node_, index_);
+    }
+    reference operator*() const {
+      return *static_cast<Node*>(node_)->slot(index_);
+    }
+    pointer operator->() const {
+      return static_cast<Node*>(node_)->slot(index_);
+    }
+    MyIterator& operator++() {
+      if (++index_ == static_cast<Node*>(node_)->count) {
+        node_ = node_->next;
+        index_ = 0;
+      }
+      return *this;
+    }
+    MyIterator operator++(int) {
+      MyIterator old = *this;
+      ++(*this);
+      return old;
+    }
+    MyIterator& operator--() {
+      if (index_ == 0) {
+        node_ = node_->prev;
+        index_ = static_cast<Node*>(node_)->count;
+      }
+      --index_;
+      return *this;
+    }
+    MyIterator operator--(int) {
+      MyIterator old = *this;
+      --(*this);
+      return old;
+    }
+    bool operator==(const MyIterator& other) const {
+      return node_ == other.node_ && index_ == other.index_;
+    }
+
+    bool operator!=(const MyIterator& other) const {
+      return !(*this == other);
+    }
+
+   private:
+    friend class UnrolledList;
+    BaseNode* node_;
+    size_t index_;
+  };
+  using iterator = MyIterator<false>;
+  using const_iterator = MyIterator<true>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  iterator begin() const { return iterator(fake_.next, 0); }
+  iterator end() const {
+    return iterator(const_cast<BaseNode*>(&fake_), 0);
+  }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+  reverse_iterator rbegin() const { return reverse_iterator(end()); }
+  reverse_iterator rend() const { return reverse_iterator(begin()); }
+  const_reverse_iterator crbegin() const {
+    return const_reverse_iterator(end());
+  }
+  const_reverse_iterator crend() const {
+    return const_reverse_iterator(begin());
+  }
+
+  UnrolledList() = default;
+  explicit UnrolledList(const Allocator& alloc) : alloc_(alloc) {}
+  UnrolledList(std::initializer_list<T> init,
+               const Allocator& alloc = Allocator())
+      : alloc_(alloc) {
+    try {
+      for (const auto& value : init) {
+        push_back(value);
+      }
+    } catch (...) {
+      clear();
+      throw;
+    }
+  }
+  UnrolledList(const UnrolledList& other)
+      : UnrolledList(other, node_traits::select_on_container_copy_construction(
+                                other.alloc_)) {}
+  UnrolledList(const UnrolledList& other, const Allocator& alloc)
+      : alloc_(alloc) {
+    try {
+      other.for_each_segment([this](const T* first, const T* last) {
+        for (; first != last; ++first) {
+          push_back(*first);
+        }
+      });
+    } catch (...) {
+      clear();
+      throw;
+    }
+  }
+  UnrolledList(UnrolledList&& other) noexcept
+      : alloc_(std::move(other.alloc_)) {
+    swap_nodes(other);
+  }
+  UnrolledList& operator=(const UnrolledList& other) {
+    if (this != &other) {
+      UnrolledList temp(other, kPropagateOnCopy ? other.alloc_ : alloc_);
+      swap_nodes(temp);
+      if constexpr (kPropagateOnCopy) {
+        std::swap(alloc_, temp.alloc_);
+      }
+    }
+    return *this;
+  }
+  UnrolledList& operator=(UnrolledList&& other) noexcept(
+      kPropagateOnMove || node_traits::is_always_equal::value) {
+    if (this == &other) {
+      return *this;
+    }
+    clear();
+    if constexpr (kPropagateOnMove) {
+      alloc_ = std::move(other.alloc_);
+    } else if (alloc_ != other.alloc_) {
+      for (auto& value : other) {
+        push_back(std::move(value));
+      }
+      other.clear();
+      return *this;
+    }
+    swap_nodes(other);
+    return *this;
+  }
+  ~UnrolledList() { clear(); }
+
+  void push_back(const T& value) { emplace_back(value); }
+  void push_back(T&& value) { emplace_back(std::move(value)); }
+  void push_front(const T& value) { emplace_front(value); }
+  void push_front(T&& value) { emplace_front(std::move(value)); }
+  template <typename... Args>
+  T& emplace_back(Args&&... args) {
+    Node* node = nullptr;
+    if (empty() || static_cast<Node*>(fake_.prev)->count == N) {
+      node = create_node(&fake_);
+      try {
+        construct(node->slot(0), std::forward<Args>(args)...);
+      } catch (...) {
+        destroy_node(node);
+        throw;
+      }
+    } else {
+      node = static_cast<Node*>(fake_.prev);
+      construct(node->slot(node->count), std::forward<Args>(args)...);
+    }
+    ++size_;
+    return *node->slot(node->count++);
+  }
+  template <typename... Args>
+  T& emplace_front(Args&&... args) {
+    return *emplace(cbegin(), std::forward<Args>(args)...);
+  }
+  // The element is built before anything is shifted, so a throwing
+  // constructor leaves the list unchanged.
+  template <typename... Args>
+  iterator emplace(const_iterator pos, Args&&... args) {
+    if (pos == cend()) {
+      emplace_back(std::forward<Args>(args)...);
+      return iterator(fake_.prev, static_cast<Node*>(fake_.prev)->count - 1);
+    }
+    T value(std::forward<Args>(args)...);
+    Node* node = static_cast<Node*>(pos.node_);
+    size_t index = pos.index_;
+    if (node->count == N) {
+      Node* upper = split(node);
+      if (index > kHalf) {
+        node = upper;
+        index -= kHalf;
+      }
+    }
+    shift_right(node, index, std::move(value));
+    ++size_;
+    return iterator(node, index);
+  }
+  iterator insert(const_iterator pos, const T& value) {
+    return emplace(pos, value);
+  }
+  iterator insert(const_iterator pos, T&& value) {
+    return emplace(pos, std::move(value));
+  }
+  iterator erase(const_iterator pos) {
+    Node* node = static_cast<Node*>(pos.node_);
+    const size_t kIndex = pos.index_;
+    std::move(node->slot(kIndex + 1), node->slot(node->count),
+              node->slot(kIndex));
+    --node->count;
+    destroy(node->slot(node->count), node->slot(node->count + 1));
+    --size_;
+    if (node->count == 0) {
+      BaseNode* next = node->next;
+      destroy_node(node);
+      return iterator(next, 0);
+    }
+    merge_with_next(node);
+    return kIndex < node->count ? iterator(node, kIndex)
+                                : iterator(node->next, 0);
+  }
+  iterator erase(const_iterator first, const_iterator last) {
+    // Erasing may merge the node of last into the node of first, so the
+    // range is counted up front.
+    for (size_t count = std::distance(first, last); count != 0; --count) {
+      first = erase(first);
+    }
+    return iterator(first.node_, first.index_);
+  }
+  void pop_back() { erase(--cend()); }
+  void pop_front() { erase(cbegin()); }
+  void clear() {
+    for (BaseNode* node = fake_.next; node != &fake_;) {
+      BaseNode* next = node->next;
+      Node* value_node = static_cast<Node*>(node);
+      destroy(value_node->slot(0), value_node->slot(value_node->count));
+      destroy_node(value_node);
+      node = next;
+    }
+    size_ = 0;
+  }
+  void swap(UnrolledList& other) noexcept {
+    swap_nodes(other);
+    if constexpr (node_traits::propagate_on_container_swap::value) {
+      std::swap(alloc_, other.alloc_);
+    }
+  }
+
+  // Calls func(first, last) on the elements of every node in order. Scans
+  // written this way run over plain arrays.
+  template <typename Func>
+  void for_each_segment(Func func) {
+    for (BaseNode* node = fake_.next; node != &fake_; node = node->next) {
+      Node* value_node = static_cast<Node*>(node);
+      func(value_node->slot(0), value_node->slot(value_node->count));
+    }
+  }
+  template <typename Func>
+  void for_each_segment(Func func) const {
+    for (BaseNode* node = fake_.next; node != &fake_; node = node->next) {
+      Node* value_node = static_cast<Node*>(node);
+      func(static_cast<const T*>(value_node->slot(0)),
+           static_cast<const T*>(value_node->slot(value_node->count)));
+    }
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size() == 0; }
+  Allocator get_allocator() const { return Allocator(alloc_); }
+
+ private:
+  template <typename... Args>
+  void construct(T* slot, Args&&... args) {
+    node_traits::construct(alloc_, slot, std::forward<Args>(args)...);
+  }
+  void destroy(T* first, T* last) {
+    for (; first != last; ++first) {
+      node_traits::destroy(alloc_, first);
+    }
+  }
+  // Allocates an empty node and links it in front of pos.
+  Node* create_node(BaseNode* pos) {
+    Node* node = node_traits::allocate(alloc_, 1);
+    ::new (node) Node;
+    node->prev = pos->prev;
+    node->next = pos;
+    pos->prev->next = node;
+    pos->prev = node;
+    return node;
+  }
+  // Unlinks and frees a node whose elements are already destroyed.
+  void destroy_node(Node* node) {
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node_traits::deallocate(alloc_, node, 1);
+  }
+  // Moves the upper half of a full node into a new node after it.
+  Node* split(Node* node) {
+    Node* upper = create_node(node->next);
+    try {
+      for (; upper->count != N - kHalf; ++upper->count) {
+        construct(upper->slot(upper->count),
+                  std::move(*node->slot(kHalf + upper->count)));
+      }
+    } catch (...) {
+      destroy(upper->slot(0), upper->slot(upper->count));
+      destroy_node(upper);
+      throw;
+    }
+    destroy(node->slot(kHalf), node->slot(N));
+    node->count = kHalf;
+    return upper;
+  }
+  // Opens a gap at index in a node with room and moves value into it.
+  void shift_right(Node* node, size_t index, T&& value) {
+    const size_t kCount = node->count;
+    if (index == kCount) {
+      construct(node->slot(kCount), std::move(value));
+      ++node->count;
+    } else {
+      // Counted as soon as it exists, so the node still destroys it if
+      // one of the moves below throws.
+      construct(node->slot(kCount), std::move(*node->slot(kCount - 1)));
+      ++node->count;
+      std::move_backward(node->slot(index), node->slot(kCount - 1),
+                         node->slot(kCount));
+      *node->slot(index) = std::move(value);
+    }
+  }
+  // Pulls the next node's elements into an under-full node when they fit.
+  // Only done when moving cannot throw, so erase never fails halfway.
+  void merge_with_next(Node* node) {
+    if constexpr (std::is_nothrow_move_constructible_v<T>) {
+      if (node->count >= kHalf || node->next == &fake_) {
+        return;
+      }
+      Node* next = static_cast<Node*>(node->next);
+      if (node->count + next->count > N) {
+        return;
+      }
+      for (size_t i = 0; i < next->count; ++i) {
+        construct(node->slot(node->count + i), std::move(*next->slot(i)));
+      }
+      destroy(next->slot(0), next->slot(next->count));
+      node->count += next->count;
+      destroy_node(next);
+    }
+  }
+  void relink_fake() {
+    if (size_ == 0) {
+      fake_.prev = fake_.next = &fake_;
+    } else {
+      fake_.next->prev = &fake_;
+      fake_.prev->next = &fake_;
+    }
+  }
+  void swap_nodes(UnrolledList& other) noexcept {
+    std::swap(fake_, other.fake_);
+    std::swap(size_, other.size_);
+    relink_fake();
+    other.relink_fake();
+  }
+};
+
+template <typename T, size_t N, typename Allocator>
+void swap(UnrolledList<T, N, Allocator>& lhs,
+          UnrolledList<T, N, Allocator>& rhs) noexcept {
+  lhs.swap(rhs);
+}
+
+namespace pmr {
+
+template <typename T, size_t N = kUnrolledListNodeSize<T>>
+using UnrolledList =
+    ::UnrolledList<T, N, std::pmr::polymorphic_allocator<T>>;
+
+}  // namespace pmr
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+
+// Chase-Lev work-stealing deque (in the C11 formulation by Le, Pop, Cohen
+// and Zappa Nardelli). The owner thread pushes and pops at the back, any
+// number of thieves steal from the front; all three are lock-free.
+// Elements live in a circular power-of-two array indexed with a mask, like
+// the arrays of Deque; when it fills up, the owner copies it into one twice
+// as large. Thieves may still be reading the old array, so it is only freed
+// together with the deque.
+//
+// In a fork-join scheduler every worker owns one deque of task handles:
+// it pops its own newest task, and when it has none it steals the oldest
+// task of a random other worker. WorkStealingDeque_bench.cpp runs such a
+// scheduler on a parallel sum.
+template <typename T, typename Allocator = std::allocator<T>>
+class WorkStealingDeque {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "WorkStealingDeque elements are copied racily, so they must "
+                "be trivially copyable (e.g. task pointers)");
+
+ public:
+  explicit WorkStealingDeque(size_t capacity = kStartCapacity,
+                             const Allocator& alloc = Allocator())
+      : alloc_(alloc) {
+    array_.store(new_array(std::bit_ceil(std::max<size_t>(capacity, 2))),
+                 std::memory_order_relaxed);
+  }
+
+  WorkStealingDeque(const WorkStealingDeque&) = delete;
+  WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+  ~WorkStealingDeque() {
+    for (Array* array = array_.load(std::memory_order_relaxed);
+         array != nullptr;) {
+      Array* retired = array->retired;
+      delete_array(array);
+      array = retired;
+    }
+  }
+
+  // Owner only.
+  void push_back(const T& value) {
+    const int64_t kBottom = bottom_.load(std::memory_order_relaxed);
+    const int64_t kTop = top_.load(std::memory_order_acquire);
+    Array* array = array_.load(std::memory_order_relaxed);
+    if (kBottom - kTop > static_cast<int64_t>(array->mask)) {
+      array = grow(array, kTop, kBottom);
+    }
+    array->at(kBottom).store(value, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(kBottom + 1, std::memory_order_relaxed);
+  }
+
+  // Owner only. Returns the most recently pushed element.
+  std::optional<T> pop_back() {
+    const int64_t kBottom = bottom_.load(std::memory_order_relaxed) - 1;
+    Array* array = array_.load(std::memory_order_relaxed);
+    bottom_.store(kBottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = top_.load(std::memory_order_relaxed);
+    if (top > kBottom) {
+      bottom_.store(kBottom + 1, std::memory_order_relaxed);
+      return std::nullopt;
+    }
+    std::optional<T> value = array->at(kBottom).load(std::memory_order_relaxed);
+    if (top == kBottom) {
+      // Last element: race the thieves for it.
+      if (!top_.compare_exchange_strong(top, top + 1,
+                                        std::memory_order_seq_cst,
+                                        std::memory_order_relaxed)) {
+        value.reset();
+      }
+      bottom_.store(kBottom + 1, std::memory_order_relaxed);
+    }
+    return value;
+  }
+
+  // Any thread. Returns the oldest element, or nothing if the deque is
+  // empty or another thread took that element first.
+  std::optional<T> steal_front() {
+    int64_t top = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t kBottom = bottom_.load(std::memory_order_acquire);
+    if (top >= kBottom) {
+      return std::nullopt;
+    }
+    Array* array = array_.load(std::memory_order_acquire);
+    T value = array->at(top).load(std::memory_order_relaxed);
+    if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      return std::nullopt;
+    }
+    return value;
+  }
+
+  // A snapshot; exact only when no other thread is running.
+  [[nodiscard]] size_t size() const {
+    const int64_t kBottom = bottom_.load(std::memory_order_relaxed);
+    const int64_t kTop = top_.load(std::memory_order_relaxed);
+    return kBottom > kTop ? static_cast<size_t>(kBottom - kTop) : 0;
+  }
+
+  [[nodiscard]] bool empty() const { return size() == 0; }
+
+ private:
+  struct Array {
+    std::atomic<T>* slots;
+    size_t mask;
+    Array* retired;
+
+    std::atomic<T>& at(int64_t index) {
+      return slots[static_cast<size_t>(index) & mask];
+    }
+  };
+
+  // Owner only: copies the live range [top, bottom) into an array twice as
+  // large and publishes it. The old array is kept for running thieves.
+  Array* grow(Array* array, int64_t top, int64_t bottom) {
+    Array* bigger = new_array((array->mask + 1) * 2);
+    for (int64_t i = top; i != bottom; ++i) {
+      bigger->at(i).store(array->at(i).load(std::memory_order_relaxed),
+                          std::memory_order_relaxed);
+    }
+    bigger->retired = array;
+    array_.store(bigger, std::memory_order_release);
+    return bigger;
+  }
+
+  Array* new_array(size_t capacity) {
+    Array* array = array_traits::allocate(array_alloc_, 1);
+    try {
+      array->slots = slot_traits::allocate(slot_alloc_, capacity);
+    } catch (...) {
+      array_traits::deallocate(array_alloc_, array, 1);
+      throw;
+    }
+    for (size_t i = 0; i < capacity; ++i) {
+      slot_traits::construct(slot_alloc_, array->slots + i);
+    }
+    array->mask = capacity - 1;
+    array->retired = nullptr;
+    return array;
+  }
+
+  void delete_array(Array* array) {
+    slot_traits::deallocate(slot_alloc_, array->slots, array->mask + 1);
+    array_traits::deallocate(array_alloc_, array, 1);
+  }
+
+  using allocator_traits = std::allocator_traits<Allocator>;
+  using slot_allocator =
+      typename allocator_traits::template rebind_alloc<std::atomic<T>>;
+  using slot_traits = std::allocator_traits<slot_allocator>;
+  using array_allocator =
+      typename allocator_traits::template rebind_alloc<Array>;
+  using array_traits = std::allocator_traits<array_allocator>;
+
+  static constexpr size_t kStartCapacity = 1024;
+  static constexpr size_t kCacheLineSize = 64;
+
+  // Written by thieves.
+  alignas(kCacheLineSize) std::atomic<int64_t> top_{0};
+  // Written by the owner.
+  alignas(kCacheLineSize) std::atomic<int64_t> bottom_{0};
+  std::atomic<Array*> array_{nullptr};
+  Allocator alloc_;
+  slot_allocator slot_alloc_{alloc_};
+  array_allocator array_alloc_{alloc_};
+};
@@ -0,0 +1,140 @@
+// Fork-join parallel sum on WorkStealingDeque: every worker owns a deque of
+// ranges, splits the range it holds in half until it is small, pushes the
+// upper halves for itself or a thief to pick up, and steals from a random
+// worker when its own deque runs dry. Prints the throughput for 1, 2, 4,
+// ... workers.
+//
+//   g++ -std=c++20 -O2 -pthread WorkStealingDeque_bench.cpp
+//   ./a.out [elements] [max_threads] [grain]
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "WorkStealingDeque.cpp"
+
+namespace {
+
+struct Range {
+  uint64_t first;
+  uint64_t last;
+};
+
+using TaskDeque = WorkStealingDeque<Range*>;
+
+uint64_t work(uint64_t value) {
+  for (int i = 0; i < 4; ++i) {
+    value = value * 0x9E3779B97F4A7C15ULL + 1;
+  }
+  return value;
+}
+
+class Scheduler {
+ public:
+  Scheduler(size_t threads, uint64_t grain)
+      : deques_(threads), grain_(grain) {
+    for (auto& deque : deques_) {
+      deque = std::make_unique<TaskDeque>();
+    }
+  }
+
+  // Sums work(i) over [0, count).
+  uint64_t sum(uint64_t count) {
+    remaining_.store(count, std::memory_order_relaxed);
+    total_.store(0, std::memory_order_relaxed);
+    deques_[0]->push_back(new Range{0, count});
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < deques_.size(); ++i) {
+      threads.emplace_back([this, i] { run(i); });
+    }
+    run(0);
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    return total_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  void run(size_t self) {
+    TaskDeque& own = *deques_[self];
+    uint64_t seed = self + 1;
+    uint64_t sum = 0;
+    while (remaining_.load(std::memory_order_acquire) != 0) {
+      std::optional<Range*> task = own.pop_back();
+      if (!task && deques_.size() > 1) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        const size_t kVictim = seed % deques_.size();
+        if (kVictim != self) {
+          task = deques_[kVictim]->steal_front();
+        }
+      }
+      if (!task) {
+        std::this_thread::yield();
+        continue;
+      }
+      sum += execute(**task, own);
+      delete *task;
+    }
+    total_.fetch_add(sum, std::memory_order_relaxed);
+  }
+
+  // Forks the upper half until the range is down to the grain, then sums
+  // what is left.
+  uint64_t execute(Range range, TaskDeque& own) {
+    while (range.last - range.first > grain_) {
+      const uint64_t kMiddle = range.first + (range.last - range.first) / 2;
+      own.push_back(new Range{kMiddle, range.last});
+      range.last = kMiddle;
+    }
+    uint64_t sum = 0;
+    for (uint64_t i = range.first; i != range.last; ++i) {
+      sum += work(i);
+    }
+    remaining_.fetch_sub(range.last - range.first, std::memory_order_release);
+    return sum;
+  }
+
+  std::vector<std::unique_ptr<TaskDeque>> deques_;
+  const uint64_t grain_;
+  std::atomic<uint64_t> remaining_{0};
+  std::atomic<uint64_t> total_{0};
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const uint64_t kElements =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200'000'000;
+  const size_t kHardware = std::max(1U, std::thread::hardware_concurrency());
+  const size_t kMaxThreads =
+      argc > 2 ? std::strtoull(argv[2], nullptr, 10) : kHardware;
+  const uint64_t kGrain =
+      argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 4096;
+
+  uint64_t expected = 0;
+  for (uint64_t i = 0; i < kElements; ++i) {
+    expected += work(i);
+  }
+  std::printf("%llu elements, grain %llu\n",
+              static_cast<unsigned long long>(kElements),
+              static_cast<unsigned long long>(kGrain));
+  for (size_t threads = 1; threads <= kMaxThreads; threads *= 2) {
+    Scheduler scheduler(threads, kGrain);
+    const auto kStart = std::chrono::steady_clock::now();
+    const uint64_t kSum = scheduler.sum(kElements);
+    const double kSeconds = std::chrono::duration<double>(
+                                std::chrono::steady_clock::now() - kStart)
+                                .count();
+    std::printf("  %3zu threads  %9.1f Melements/s%s\n", threads,
+                kElements / kSeconds / 1e6,
+                kSum == expected ? "" : "  WRONG SUM");
+  }
+}